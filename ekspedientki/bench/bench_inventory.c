@@ -0,0 +1,108 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "catalog.h"
+#include "product.h"
+#include "stats.h"
+
+/**
+ * Inventory Benchmark
+ *
+ * Runs 1 to NUM_STOCK_SHARDS threads that each take random products
+ * through their own stock shard, and reports the aggregate rate. The
+ * catalog holds enough stock that no product runs out. Rebuild with
+ * -DSTOCK_REFILL_BATCH=1 to compare against taking every unit from the
+ * shared central inventory, and with a larger NUM_CLERKS for more shards.
+ *
+ * Usage: bench_inventory [TAKES_PER_THREAD]
+ */
+
+#define NUM_PRODUCTS 1000
+#define CATALOG_FILE "/tmp/ekspedientki_bench_catalog.bin"
+
+typedef struct bench_thread_t {
+    pthread_t thread;
+    int shard;
+    long takes;
+    long sold;
+} bench_thread_t;
+
+/**
+ * Writes a catalog with stock for every take of every thread.
+ */
+static void write_catalog(long takes) {
+    product_t* rows = calloc(NUM_PRODUCTS, sizeof(product_t));
+    if (rows == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        exit(1);
+    }
+    long stock = takes * NUM_STOCK_SHARDS;
+    for (int i = 0; i < NUM_PRODUCTS; i++) {
+        rows[i].id = i;
+        snprintf(rows[i].name, sizeof(rows[i].name), "Product %d", i);
+        rows[i].price = 100;
+        rows[i].stock = stock < 1000000000 ? (int)stock : 1000000000;
+    }
+
+    catalog_t catalog;
+    catalog_build(&catalog, rows, NUM_PRODUCTS);
+    FILE* file = fopen(CATALOG_FILE, "wb");
+    if (file == NULL || fwrite(catalog.block, 1, catalog.block_size, file) != catalog.block_size) {
+        fprintf(stderr, "Error: cannot write %s\n", CATALOG_FILE);
+        exit(1);
+    }
+    fclose(file);
+    catalog_destroy(&catalog);
+    free(rows);
+}
+
+static void* take_products(void* arg) {
+    bench_thread_t* t = (bench_thread_t*)arg;
+    uint32_t state = 2463534242u + t->shard;
+    for (long i = 0; i < t->takes; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        t->sold += try_get_product(t->shard, product_id_at(state % product_count()));
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    long takes = argc > 1 ? atol(argv[1]) : 2000000;
+    if (takes <= 0) {
+        fprintf(stderr, "Usage: %s [TAKES_PER_THREAD]\n", argv[0]);
+        return 1;
+    }
+
+    write_catalog(takes);
+    set_product_catalog(CATALOG_FILE);
+
+    printf("[bench] shards=%d refill_batch=%d takes_per_thread=%ld\n", NUM_STOCK_SHARDS, STOCK_REFILL_BATCH, takes);
+    for (int threads = 1; threads <= NUM_STOCK_SHARDS; threads++) {
+        initialize_products();
+
+        bench_thread_t workers[NUM_STOCK_SHARDS];
+        long long start_ns = now_ns();
+        for (int i = 0; i < threads; i++) {
+            workers[i].shard = i;
+            workers[i].takes = takes;
+            workers[i].sold = 0;
+            pthread_create(&workers[i].thread, NULL, take_products, &workers[i]);
+        }
+        long sold = 0;
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i].thread, NULL);
+            sold += workers[i].sold;
+        }
+        long long elapsed_ns = now_ns() - start_ns;
+
+        printf("[bench] threads=%d sold=%ld rate=%.2f Mtakes/s\n",
+               threads, sold, (double)takes * threads / (elapsed_ns / 1e3));
+        destroy_products();
+    }
+    remove(CATALOG_FILE);
+    return 0;
+}
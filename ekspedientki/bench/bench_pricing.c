@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "catalog.h"
+#include "pricing.h"
+#include "product.h"
+#include "stats.h"
+
+/**
+ * Basket Pricing Benchmark
+ *
+ * Prices the same random baskets under promotion rule sets of growing size,
+ * with the vectorized and the scalar pricing code, and checks that both
+ * give the same totals. The time per basket should not depend on the
+ * number of rules, only on the basket size.
+ *
+ * Usage: bench_pricing [NUM_PRODUCTS] [NUM_BASKETS]
+ */
+
+#define MAX_BASKET 24
+#define NUM_CATEGORIES 16
+#define HOT_PRODUCTS 32
+#define CATALOG_FILE "/tmp/ekspedientki_bench_catalog.bin"
+#define RULES_FILE "/tmp/ekspedientki_bench_rules.txt"
+
+/**
+ * Xorshift generator, so every run sees the same baskets and rules.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Writes a catalog of num_products products for the product module to map.
+ */
+static void write_catalog(int num_products) {
+    product_t* rows = calloc(num_products, sizeof(product_t));
+    if (rows == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < num_products; i++) {
+        rows[i].id = i;
+        snprintf(rows[i].name, sizeof(rows[i].name), "Product %d", i);
+        rows[i].price = 99 + (i * 37) % 1900;
+        rows[i].stock = 10;
+        rows[i].category = i % NUM_CATEGORIES;
+    }
+
+    catalog_t catalog;
+    catalog_build(&catalog, rows, num_products);
+    FILE* file = fopen(CATALOG_FILE, "wb");
+    if (file == NULL || fwrite(catalog.block, 1, catalog.block_size, file) != catalog.block_size) {
+        fprintf(stderr, "Error: cannot write %s\n", CATALOG_FILE);
+        exit(1);
+    }
+    fclose(file);
+    catalog_destroy(&catalog);
+    free(rows);
+}
+
+/**
+ * Writes a rules file with num_rules rules of every kind, mixed.
+ */
+static void write_rules(int num_rules, int num_products) {
+    FILE* file = fopen(RULES_FILE, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: cannot write %s\n", RULES_FILE);
+        exit(1);
+    }
+    uint32_t state = 88172645u;
+    int coupons = 0;
+    for (int i = 0; i < num_rules; i++) {
+        switch (i % 3) {
+        case 0:
+            fprintf(file, "category,%u,%u\n", next_random(&state) % NUM_CATEGORIES, next_random(&state) % 50);
+            break;
+        case 1:
+            // Half the offers land on the hot products so they actually trigger
+            fprintf(file, "multibuy,%u,%u\n",
+                    next_random(&state) % (i % 2 ? HOT_PRODUCTS : num_products), 2 + next_random(&state) % 3);
+            break;
+        default:
+            if (coupons < MAX_COUPONS) {
+                fprintf(file, "coupon,%u,%u\n", next_random(&state) % 5000, next_random(&state) % 1000);
+                coupons++;
+            } else {
+                fprintf(file, "category,%u,%u\n", next_random(&state) % NUM_CATEGORIES, next_random(&state) % 50);
+            }
+            break;
+        }
+    }
+    fclose(file);
+}
+
+int main(int argc, char** argv) {
+    int num_products = argc > 1 ? atoi(argv[1]) : 100000;
+    int num_baskets = argc > 2 ? atoi(argv[2]) : 500000;
+    if (num_products < HOT_PRODUCTS || num_baskets <= 0) {
+        fprintf(stderr, "Usage: %s [NUM_PRODUCTS >= %d] [NUM_BASKETS]\n", argv[0], HOT_PRODUCTS);
+        return 1;
+    }
+
+    write_catalog(num_products);
+    set_product_catalog(CATALOG_FILE);
+    initialize_products();
+
+    // Baskets of 1 to MAX_BASKET items, half of them from a few hot products
+    int* sizes = malloc(sizeof(int) * num_baskets);
+    int* items = malloc(sizeof(int) * (size_t)num_baskets * MAX_BASKET);
+    if (sizes == NULL || items == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        return 1;
+    }
+    uint32_t state = 2463534242u;
+    for (int b = 0; b < num_baskets; b++) {
+        sizes[b] = 1 + next_random(&state) % MAX_BASKET;
+        for (int i = 0; i < sizes[b]; i++) {
+            uint32_t r = next_random(&state);
+            items[(long)b * MAX_BASKET + i] = r % 2 ? (int)(r / 2 % HOT_PRODUCTS) : (int)(r / 2 % num_products);
+        }
+    }
+
+    printf("[bench] products=%d baskets=%d max_basket=%d\n", num_products, num_baskets, MAX_BASKET);
+    int rule_counts[] = { 0, 10, 100, 1000, 10000 };
+    for (size_t r = 0; r < sizeof(rule_counts) / sizeof(rule_counts[0]); r++) {
+        write_rules(rule_counts[r], num_products);
+        set_promotions_file(RULES_FILE);
+        pricing_init();
+        int coupons = pricing_num_coupons();
+
+        long long start_ns = now_ns();
+        long long vector_total = 0;
+        for (int b = 0; b < num_baskets; b++) {
+            int coupon = coupons > 0 && b % 4 == 0 ? b % coupons : NO_COUPON;
+            vector_total += pricing_price_basket(&items[(long)b * MAX_BASKET], sizes[b], coupon);
+        }
+        long long vector_ns = now_ns() - start_ns;
+
+        start_ns = now_ns();
+        long long scalar_total = 0;
+        for (int b = 0; b < num_baskets; b++) {
+            int coupon = coupons > 0 && b % 4 == 0 ? b % coupons : NO_COUPON;
+            scalar_total += pricing_price_basket_scalar(&items[(long)b * MAX_BASKET], sizes[b], coupon);
+        }
+        long long scalar_ns = now_ns() - start_ns;
+
+        if (vector_total != scalar_total) {
+            fprintf(stderr, "Error: vectorized and scalar totals differ (%lld vs %lld)\n", vector_total, scalar_total);
+            return 1;
+        }
+        printf("[bench] rules=%d %s=%.1f ns/basket scalar=%.1f ns/basket total=%lld\n",
+               rule_counts[r], pricing_vectorized() ? "avx2" : "scalar",
+               (double)vector_ns / num_baskets, (double)scalar_ns / num_baskets, vector_total);
+        pricing_destroy();
+    }
+
+    destroy_products();
+    remove(CATALOG_FILE);
+    remove(RULES_FILE);
+    free(items);
+    free(sizes);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "catalog.h"
+#include "product.h"
+#include "stats.h"
+
+/**
+ * Product Table Benchmark
+ *
+ * Prices baskets of random products and counts their assistant items,
+ * once through the product module's columnar catalog and once through a
+ * replica of the old array-of-structs table, where every lookup pulls the
+ * inline name into cache along with the price and flags.
+ *
+ * Usage: bench_products [NUM_PRODUCTS] [NUM_BASKETS]
+ */
+
+#define BASKET_SIZE 10
+#define CATALOG_FILE "/tmp/ekspedientki_bench_catalog.bin"
+
+/**
+ * Xorshift generator, so every layout sees the same baskets.
+ */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Writes a catalog for the product module to map.
+ */
+static void write_catalog(const catalog_t* catalog) {
+    FILE* file = fopen(CATALOG_FILE, "wb");
+    if (file == NULL || fwrite(catalog->block, 1, catalog->block_size, file) != catalog->block_size) {
+        fprintf(stderr, "Error: cannot write %s\n", CATALOG_FILE);
+        exit(1);
+    }
+    fclose(file);
+}
+
+int main(int argc, char** argv) {
+    int num_products = argc > 1 ? atoi(argv[1]) : 1000000;
+    int num_baskets = argc > 2 ? atoi(argv[2]) : 2000000;
+    if (num_products <= 0 || num_baskets <= 0) {
+        fprintf(stderr, "Usage: %s [NUM_PRODUCTS] [NUM_BASKETS]\n", argv[0]);
+        return 1;
+    }
+
+    // Array-of-structs table, the layout of the original products[] array
+    product_t* rows = calloc(num_products, sizeof(product_t));
+    if (rows == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        return 1;
+    }
+    for (int i = 0; i < num_products; i++) {
+        rows[i].id = i;
+        snprintf(rows[i].name, sizeof(rows[i].name), "Product %d", i);
+        rows[i].price = 99 + (i * 37) % 1900;
+        rows[i].stock = 10;
+        rows[i].needs_assistant = i % 10 == 9;
+        rows[i].prep_cost = rows[i].needs_assistant ? 1 : 0;
+    }
+
+    // Both layouts resolve ids through the same id->slot index
+    catalog_t index;
+    catalog_build(&index, rows, num_products);
+    write_catalog(&index);
+    set_product_catalog(CATALOG_FILE);
+    initialize_products();
+
+    int* baskets = malloc(sizeof(int) * (size_t)num_baskets * BASKET_SIZE);
+    if (baskets == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        return 1;
+    }
+    uint32_t state = 2463534242u;
+    for (long i = 0; i < (long)num_baskets * BASKET_SIZE; i++) {
+        baskets[i] = next_random(&state) % num_products;
+    }
+
+    // Touch every page of both tables once so neither run pays for page faults
+    long long warm = price_basket(baskets, 0);
+    for (int i = 0; i < num_products; i++) {
+        warm += get_product_price(i) + rows[i].price;
+    }
+
+    double items = (double)num_baskets * BASKET_SIZE;
+    printf("[bench] products=%d baskets=%d basket_size=%d checksum=%lld\n",
+           num_products, num_baskets, BASKET_SIZE, warm % 1000);
+    printf("[bench] bytes per product: aos=%zu soa_price=%zu soa_price_and_flags=%zu\n",
+           sizeof(product_t), sizeof(int32_t), sizeof(int32_t) + sizeof(uint8_t));
+
+    // Pricing only, what the clerk does when it finalizes a transaction
+    long long start_ns = now_ns();
+    long long aos_total = 0;
+    for (int b = 0; b < num_baskets; b++) {
+        const int* basket = &baskets[(long)b * BASKET_SIZE];
+        for (int i = 0; i < BASKET_SIZE; i++) {
+            aos_total += rows[catalog_slot(&index, basket[i])].price;
+        }
+    }
+    long long aos_ns = now_ns() - start_ns;
+
+    start_ns = now_ns();
+    long long soa_total = 0;
+    for (int b = 0; b < num_baskets; b++) {
+        soa_total += price_basket(&baskets[(long)b * BASKET_SIZE], BASKET_SIZE);
+    }
+    long long soa_ns = now_ns() - start_ns;
+    printf("[bench] price: aos=%.2f ns/item soa=%.2f ns/item\n", aos_ns / items, soa_ns / items);
+
+    // Pricing and checking for assistant items
+    start_ns = now_ns();
+    long aos_assisted = 0;
+    for (int b = 0; b < num_baskets; b++) {
+        const int* basket = &baskets[(long)b * BASKET_SIZE];
+        for (int i = 0; i < BASKET_SIZE; i++) {
+            const product_t* p = &rows[catalog_slot(&index, basket[i])];
+            aos_total += p->price;
+            aos_assisted += p->needs_assistant;
+        }
+    }
+    aos_ns = now_ns() - start_ns;
+
+    start_ns = now_ns();
+    long soa_assisted = 0;
+    for (int b = 0; b < num_baskets; b++) {
+        const int* basket = &baskets[(long)b * BASKET_SIZE];
+        soa_total += price_basket(basket, BASKET_SIZE);
+        soa_assisted += count_assistant_items(basket, BASKET_SIZE);
+    }
+    soa_ns = now_ns() - start_ns;
+    printf("[bench] price+check: aos=%.2f ns/item soa=%.2f ns/item\n", aos_ns / items, soa_ns / items);
+
+    if (aos_total != soa_total || aos_assisted != soa_assisted) {
+        fprintf(stderr, "Error: layouts disagree (%lld/%ld vs %lld/%ld)\n",
+                aos_total, aos_assisted, soa_total, soa_assisted);
+        return 1;
+    }
+
+    destroy_products();
+    catalog_destroy(&index);
+    remove(CATALOG_FILE);
+    free(baskets);
+    free(rows);
+    return 0;
+}
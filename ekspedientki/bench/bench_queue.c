@@ -0,0 +1,155 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "queue.h"
+#include "stats.h"
+
+/**
+ * Queue Consumer Benchmark
+ *
+ * NUM_PRODUCERS threads each push items into their own queue, pausing
+ * PAUSE_US microseconds after every item so the consumer is often idle,
+ * and one consumer takes every item with one of these strategies:
+ *   blocking  queue_pop() on a single queue all producers share
+ *   polling   queue_try_pop() over the producer queues in a busy loop
+ *   timeout   queue_pop_timeout() on each producer queue in turn
+ *   select    queue_select() over the producer queues
+ * For each strategy it reports the rate, the CPU time the consumer burned
+ * relative to the run time, and the push-to-pop latency.
+ *
+ * Usage: bench_queue [ITEMS_PER_PRODUCER] [PAUSE_US]
+ */
+
+#define NUM_PRODUCERS 4
+
+/** Wait of each queue_pop_timeout() call in the timeout strategy */
+#define TIMEOUT_SLICE_NS 50000
+
+typedef enum consumer_mode_t {
+    MODE_BLOCKING,
+    MODE_POLLING,
+    MODE_TIMEOUT,
+    MODE_SELECT,
+    NUM_MODES
+} consumer_mode_t;
+
+static const char* mode_names[NUM_MODES] = { "blocking", "polling", "timeout", "select" };
+
+typedef struct item_t {
+    long long pushed_ns;
+} item_t;
+
+typedef struct producer_t {
+    pthread_t thread;
+    queue* queue;
+    item_t* items;
+    long count;
+    long pause_us;
+} producer_t;
+
+static void* produce(void* arg) {
+    producer_t* p = (producer_t*)arg;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = p->pause_us * 1000 };
+    for (long i = 0; i < p->count; i++) {
+        p->items[i].pushed_ns = now_ns();
+        queue_push(p->queue, &p->items[i]);
+        if (p->pause_us > 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Takes the next item with the given strategy.
+ */
+static item_t* consume(consumer_mode_t mode, queue** queues, int* next) {
+    void* item = NULL;
+    switch (mode) {
+    case MODE_BLOCKING:
+        item = queue_pop(queues[0]);
+        break;
+    case MODE_POLLING:
+        while (item == NULL) {
+            item = queue_try_pop(queues[*next]);
+            *next = (*next + 1) % NUM_PRODUCERS;
+        }
+        break;
+    case MODE_TIMEOUT:
+        while (item == NULL) {
+            item = queue_pop_timeout(queues[*next], TIMEOUT_SLICE_NS);
+            *next = (*next + 1) % NUM_PRODUCERS;
+        }
+        break;
+    default:
+        queue_select(queues, NUM_PRODUCERS, &item, -1);
+        break;
+    }
+    return (item_t*)item;
+}
+
+static long long thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? atol(argv[1]) : 20000;
+    long pause_us = argc > 2 ? atol(argv[2]) : 20;
+    if (count <= 0 || pause_us < 0) {
+        fprintf(stderr, "Usage: %s [ITEMS_PER_PRODUCER] [PAUSE_US]\n", argv[0]);
+        return 1;
+    }
+
+    printf("[bench] producers=%d items_per_producer=%ld pause=%ldus\n", NUM_PRODUCERS, count, pause_us);
+    for (int mode = 0; mode < NUM_MODES; mode++) {
+        queue* queues[NUM_PRODUCERS];
+        producer_t producers[NUM_PRODUCERS];
+        for (int i = 0; i < NUM_PRODUCERS; i++) {
+            queues[i] = mode == MODE_BLOCKING && i > 0 ? queues[0] : queue_create();
+            if (mode == MODE_SELECT) {
+                queue_event_fd(queues[i]);
+            }
+            producers[i].queue = queues[i];
+            producers[i].count = count;
+            producers[i].pause_us = pause_us;
+            producers[i].items = malloc(sizeof(item_t) * count);
+            if (producers[i].items == NULL) {
+                fprintf(stderr, "Error: malloc failed\n");
+                return 1;
+            }
+        }
+
+        long long start_ns = now_ns();
+        long long start_cpu_ns = thread_cpu_ns();
+        for (int i = 0; i < NUM_PRODUCERS; i++) {
+            pthread_create(&producers[i].thread, NULL, produce, &producers[i]);
+        }
+
+        int next = 0;
+        long long latency_ns = 0;
+        for (long n = 0; n < count * NUM_PRODUCERS; n++) {
+            item_t* item = consume((consumer_mode_t)mode, queues, &next);
+            latency_ns += now_ns() - item->pushed_ns;
+        }
+        long long cpu_ns = thread_cpu_ns() - start_cpu_ns;
+        long long elapsed_ns = now_ns() - start_ns;
+
+        for (int i = 0; i < NUM_PRODUCERS; i++) {
+            pthread_join(producers[i].thread, NULL);
+            free(producers[i].items);
+            if (mode != MODE_BLOCKING || i == 0) {
+                queue_destroy(queues[i]);
+            }
+        }
+
+        printf("[bench] mode=%s rate=%.1f kitems/s consumer_cpu=%.1f%% latency_mean=%.1fus\n",
+               mode_names[mode], count * NUM_PRODUCERS / (elapsed_ns / 1e6),
+               100.0 * cpu_ns / elapsed_ns, latency_ns / 1e3 / (count * NUM_PRODUCERS));
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#!/bin/sh
+# Builds and runs the simulation once per configuration and prints the
+# [stats] lines of every run, prefixed by the configuration that produced them.
+#
+# Each argument is one configuration: a list of -D flags passed to the
+# compiler through EXTRA_CFLAGS. An empty string runs the defaults.
+#
+# Examples:
+#   Latency-vs-throughput curve for open-loop Poisson arrivals:
+#     ./benchmark.sh "-DARRIVAL_MODE=ARRIVAL_POISSON -DARRIVAL_RATE=2000" \
+#                    "-DARRIVAL_MODE=ARRIVAL_POISSON -DARRIVAL_RATE=4000" \
+#                    "-DARRIVAL_MODE=ARRIVAL_POISSON -DARRIVAL_RATE=8000"
+#   The saturation point is the offered rate where the measured rate stops
+#   following it and the latency percentiles start to grow without bound.
+#   Effect of thread placement:
+#     ./benchmark.sh "-DPLACEMENT_POLICY=PLACEMENT_NONE" \
+#                    "-DPLACEMENT_POLICY=PLACEMENT_COMPACT" \
+#                    "-DPLACEMENT_POLICY=PLACEMENT_SCATTER"
+#   Per-item handshake latency, spin-then-park against parking immediately:
+#     ./benchmark.sh "" "-DSPIN_PARK_MAX_SPINS=0"
+#   Assistant throughput with full, coalesced and memoized preparation:
+#     ./benchmark.sh "-DASSISTANT_WORK_INTENSITY=1000 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL" \
+#                    "-DASSISTANT_WORK_INTENSITY=1000 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_COALESCE" \
+#                    "-DASSISTANT_WORK_INTENSITY=1000 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_MEMOIZE"
+#   Clerk wait time under FIFO, shortest-job-first and earliest-deadline-first
+#   assistant scheduling (see the clerk_job_wait percentiles):
+#     ./benchmark.sh "-DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DASSISTANT_SCHEDULER=ASSISTANT_SCHED_FIFO" \
+#                    "-DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DASSISTANT_SCHEDULER=ASSISTANT_SCHED_SJF" \
+#                    "-DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DASSISTANT_SCHEDULER=ASSISTANT_SCHED_EDF"
+#   Stockout rate and central inventory CAS retries with and without restocking:
+#     ./benchmark.sh "-DNUM_CUSTOMERS=5000 -DRESTOCK_MODE=RESTOCK_NONE" \
+#                    "-DNUM_CUSTOMERS=5000 -DRESTOCK_MODE=RESTOCK_SCHEDULED" \
+#                    "-DNUM_CUSTOMERS=5000 -DRESTOCK_MODE=RESTOCK_THRESHOLD"
+#   Which mutexes are contended, ranked by total wait time:
+#     ./benchmark.sh "-DENABLE_LOCK_PROFILING=1 -DNUM_CUSTOMERS=2000"
+#   Static admission against adaptive admission holding a queue wait p99 target:
+#     ./benchmark.sh "-DNUM_CUSTOMERS=2000" \
+#                    "-DNUM_CUSTOMERS=2000 -DADMISSION_MODE=ADMISSION_ADAPTIVE -DADMISSION_TARGET_P99_US=100"
+#   Load shedding: customers who give up after about 2ms in a queue, and who
+#   do not join queues of 8 or more:
+#     ./benchmark.sh "-DNUM_CUSTOMERS=2000" \
+#                    "-DNUM_CUSTOMERS=2000 -DCUSTOMER_PATIENCE_US=2000 -DBALK_QUEUE_LENGTH=8"
+#   Clerk-seconds against latency with a fixed and an elastic pool of six lanes:
+#     ./benchmark.sh "-DNUM_CLERKS=6 -DARRIVAL_MODE=ARRIVAL_BURSTY -DARRIVAL_RATE=8000 -DNUM_CUSTOMERS=2000" \
+#                    "-DNUM_CLERKS=6 -DARRIVAL_MODE=ARRIVAL_BURSTY -DARRIVAL_RATE=8000 -DNUM_CUSTOMERS=2000 -DCLERK_POOL_MODE=CLERK_POOL_ELASTIC"
+#   Latency by basket size without and with an express lane for small baskets:
+#     ./benchmark.sh "-DNUM_CLERKS=4 -DNUM_CUSTOMERS=2000" \
+#                    "-DNUM_CLERKS=4 -DNUM_CUSTOMERS=2000 -DNUM_EXPRESS_LANES=1"
+#   Throughput of four clerks against three clerks and one self-checkout kiosk:
+#     ./benchmark.sh "-DNUM_CLERKS=4 -DNUM_CUSTOMERS=2000" \
+#                    "-DNUM_CLERKS=3 -DNUM_CUSTOMERS=2000 -DNUM_KIOSKS=1"
+#   Clerks serving one customer at a time against four at a time while
+#   baskets wait for a slow assistant (see assistant_blocked):
+#     ./benchmark.sh "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL" \
+#                    "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DCLERK_MAX_INFLIGHT=4"
+#   Serial lanes against pipelined lanes, where a cashier takes payment
+#   while the clerk scans the next customer:
+#     ./benchmark.sh "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL" \
+#                    "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DCLERK_PIPELINE_DEPTH=2"
+#   Clerks serving four customers, blocking on one queue at a time against
+#   waiting on new customers and finished jobs together:
+#     ./benchmark.sh "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DCLERK_MAX_INFLIGHT=4" \
+#                    "-DASSISTANT_WORK_INTENSITY=20 -DASSISTANT_PREP_MODE=ASSISTANT_PREP_FULL -DCLERK_MAX_INFLIGHT=4 -DCLERK_WAIT_MODE=CLERK_WAIT_EPOLL"
+
+if [ $# -eq 0 ]; then
+    set -- ""
+fi
+
+for config in "$@"; do
+    echo "=== config: ${config:-defaults}"
+    if ! make release EXTRA_CFLAGS="$config" > /dev/null 2>&1; then
+        echo "Compilation failed!"
+        exit 1
+    fi
+    ./bin/ekspedientki | grep '^\[stats\]'
+done
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Generates a synthetic CSV product catalog for load and scaling tests.
+#
+# Usage: ./gen_catalog.sh NUM_PRODUCTS > catalog.csv
+#
+# Every tenth product needs the assistant, with a preparation cost of 1 to 8.
+# Products are spread over 16 categories.
+# Convert the CSV into the binary catalog, which loads with a single mmap:
+#   ./bin/ekspedientki --compile-catalog catalog.csv catalog.bin
+#   ./bin/ekspedientki --catalog catalog.bin
+
+if [ $# -ne 1 ]; then
+    echo "Usage: $0 NUM_PRODUCTS" >&2
+    exit 1
+fi
+
+awk -v n="$1" 'BEGIN {
+    print "id,name,price,stock,needs_assistant,prep_cost,category"
+    for (i = 0; i < n; i++) {
+        assist = (i % 10 == 9)
+        cost = assist ? 1 + (i * 7) % 8 : 0
+        printf "%d,Product %d,%d,%d,%d,%d,%d\n", i, i, 99 + (i * 37) % 1900, 10 + (i * 13) % 60, assist, cost, i % 16
+    }
+}'
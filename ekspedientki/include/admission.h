@@ -0,0 +1,65 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+/**
+ * Admission Module
+ *
+ * This module limits how many customers can be inside the shop at once.
+ * Admission is a counting semaphore of free slots: a spawner takes a slot
+ * before creating a customer and the customer gives it back when leaving.
+ * No lock is shared between spawners and exiting customers, so customer
+ * creation never delays customers on their way out.
+ *
+ * With ADMISSION_ADAPTIVE the limit follows the time customers wait in the
+ * clerk queues (AIMD): clerks report every wait, and after each window of
+ * ADMISSION_WINDOW waits the limit grows by one customer if the window's p99
+ * met ADMISSION_TARGET_P99_US, or drops by ADMISSION_DECREASE_PCT if it did
+ * not. A larger limit adds slots to the semaphore; a smaller one takes free
+ * slots back and keeps the slots of the next leaving customers until the
+ * shop is down to the new limit.
+ */
+
+/**
+ * Initializes the admission slots.
+ *
+ * @param limit Maximum number of customers allowed in the shop at once,
+ *              the starting limit with ADMISSION_ADAPTIVE
+ */
+void admission_init(int limit);
+
+/**
+ * Takes one admission slot, blocking until one is free.
+ */
+void admission_acquire();
+
+/**
+ * Returns one admission slot, waking a blocked spawner if there is one.
+ */
+void admission_release();
+
+/**
+ * Reports how long a customer waited in a clerk queue. Drives the limit
+ * with ADMISSION_ADAPTIVE, does nothing otherwise. Thread-safe.
+ *
+ * @param wait_ns Time from joining the queue to being picked by a clerk, in nanoseconds
+ */
+void admission_record_wait(long long wait_ns);
+
+/**
+ * Gets the current admission limit.
+ *
+ * @return Maximum number of customers currently allowed in the shop
+ */
+int admission_limit();
+
+/**
+ * Prints how the limit moved during the simulation (ADMISSION_ADAPTIVE only).
+ */
+void admission_report();
+
+/**
+ * Frees the resources used by the admission slots.
+ */
+void admission_destroy();
+
+#endif /* ADMISSION_H */
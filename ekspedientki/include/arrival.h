@@ -0,0 +1,47 @@
+#ifndef ARRIVAL_H
+#define ARRIVAL_H
+
+#include "parameters.h"
+
+/**
+ * Arrival Module
+ *
+ * This module generates the open-loop arrival schedule for customers.
+ * In the open-loop modes customers arrive at precomputed times, independent
+ * of how fast the shop serves them, so queueing delay under load becomes
+ * visible instead of being hidden by the spawner waiting for free slots.
+ * Customer latency is measured from the scheduled arrival time, which avoids
+ * coordinated omission when the spawner itself falls behind.
+ */
+
+/**
+ * Computes the arrival schedule for the given number of customers according
+ * to ARRIVAL_MODE, ARRIVAL_RATE and the burst parameters.
+ * The schedule is deterministic for a given ARRIVAL_SEED.
+ *
+ * @param num_customers Number of customers to schedule
+ */
+void arrival_schedule_init(int num_customers);
+
+/**
+ * Returns the scheduled arrival time of a customer, relative to the start
+ * of the simulation.
+ *
+ * @param customer_id ID of the customer
+ * @return Arrival offset in nanoseconds
+ */
+long long arrival_offset_ns(int customer_id);
+
+/**
+ * Frees the arrival schedule.
+ */
+void arrival_schedule_destroy();
+
+/**
+ * Returns a human-readable name of the configured arrival mode.
+ *
+ * @return Name of ARRIVAL_MODE
+ */
+const char* arrival_mode_name();
+
+#endif /* ARRIVAL_H */
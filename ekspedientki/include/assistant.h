@@ -5,7 +5,8 @@
 #include <math.h>
 #include <stdbool.h>
 
-#include "queue.h"
+#include "iqueue.h"
+#include "pqueue.h"
 #include "parameters.h"
 
 /**
@@ -17,14 +18,9 @@
  */
 
 /**
- * Queue for assistant tasks.
+ * Queue for assistant tasks, ordered by ASSISTANT_SCHEDULER.
  */
-extern queue* assistant_queue;
-
-/**
- * Clerk inbox queues. Each clerk has their own inbox for receiving completed jobs.
- */
-extern queue** clerk_inboxes;
+extern pqueue* assistant_queue;
 
 /**
  * Assistant thread ID.
@@ -37,11 +33,27 @@ extern pthread_t assistant_thread_id;
 typedef struct assistant_job_t {
     int product_id;           // Product that needs assistance
     int clerk_id;             // ID of the clerk requesting assistance
+    int slot;                 // Customer slot of the clerk the job belongs to, 0 unless set by the clerk
     int job_id;               // Unique ID for this job
+    int cost;                 // Preparation cost of the product
+    long long deadline_ns;    // Time the requesting clerk started waiting, used by EDF
+    struct assistant_job_t* queue_next; // Next job in the clerk inbox
 } assistant_job_t;
 
 /**
- * Initialize clerk inboxes. Call this before starting the assistant thread.
+ * Intrusive queue of finished jobs, linked through queue_next, for the
+ * clerk inboxes. See iqueue.h for its functions.
+ */
+IQUEUE_DECLARE(job_queue, assistant_job_t);
+
+/**
+ * Clerk inbox queues. Each clerk has their own inbox for receiving completed jobs.
+ */
+extern job_queue_t** clerk_inboxes;
+
+/**
+ * Initialize the clerk inbox array. Call this before starting the assistant thread.
+ * Each clerk creates its own inbox when its thread starts.
  */
 void initialize_clerk_inboxes();
 
@@ -59,6 +71,13 @@ void cleanup_clerk_inboxes();
  */
 assistant_job_t* create_assistant_job(int product_id, int clerk_id);
 
+/**
+ * Queues a job for the assistant with the priority given by ASSISTANT_SCHEDULER.
+ * 
+ * @param job Pointer to the job, its deadline_ns must be set for EDF
+ */
+void assistant_submit_job(assistant_job_t* job);
+
 /**
  * Wait for all assistant jobs created by this clerk to complete.
  * 
@@ -74,9 +93,17 @@ void wait_for_clerk_jobs(int clerk_id, int pending_jobs);
  */
 void free_assistant_job(assistant_job_t* job);
 
+/**
+ * Prints the assistant's job throughput and how many preparations were
+ * actually computed. Call after the assistant thread has been joined.
+ */
+void assistant_report();
+
 /**
  * Main function for the assistant thread.
- * Processes jobs from the assistant_queue until receiving a SENTINEL_VALUE.
+ * Takes queued jobs in batches from the assistant_queue and prepares them
+ * according to ASSISTANT_PREP_MODE, handing each job back to its clerk as
+ * soon as it is ready, until receiving a SENTINEL_VALUE.
  * 
  * @param arg Unused, should be NULL
  * @return Always returns NULL
@@ -0,0 +1,176 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "product.h"
+
+/**
+ * Catalog Module
+ *
+ * This module loads the product catalog from a file and indexes it.
+ * A catalog is one contiguous block: a header, one column per product field
+ * in slot order, a string pool holding the names, and two open-addressing
+ * hash indexes, one of slots by product id and one of slots by name. Both
+ * indexes are sized by the number of products, so ids can be anywhere in
+ * the non-negative int range. Keeping each field in its own column means
+ * the hot paths, which read only prices, stock and flags, fill cache lines
+ * with nothing but the values they need.
+ * The binary catalog file is that block written out as-is, so loading it
+ * is a read-only mmap with no parsing or copying, followed by one pass over
+ * the indexes that checks them against the columns, probing the id index
+ * for every product. CSV catalogs are parsed into the same block in memory.
+ *
+ * CSV format, one product per line after a header line:
+ *   id,name,price,stock,needs_assistant,prep_cost[,category]
+ * The category is optional and defaults to 0.
+ */
+
+/** Identifies a binary catalog file, the last digit is the format version */
+#define CATALOG_MAGIC "EKSCAT3"
+
+/** Bits of the flags column */
+#define PRODUCT_FLAG_NEEDS_ASSISTANT 0x01
+
+/** Longest CSV line the loader accepts */
+#define CATALOG_MAX_LINE 256
+
+/**
+ * Header at the start of a catalog block. All offsets are in bytes from the
+ * start of the block.
+ */
+typedef struct catalog_header_t {
+    char magic[8];               // CATALOG_MAGIC
+    int32_t count;               // Number of products
+    int32_t id_index_size;       // Number of id index buckets, a power of two
+    int32_t name_index_size;     // Number of name index buckets, a power of two
+    uint32_t names_size;         // Size of the name string pool in bytes
+    uint64_t ids_offset;         // int32_t[count], product id of each slot
+    uint64_t prices_offset;      // int32_t[count], price in cents
+    uint64_t stock_offset;       // int32_t[count], base stock
+    uint64_t prep_costs_offset;  // int32_t[count], assistant preparation cost
+    uint64_t flags_offset;       // uint8_t[count], PRODUCT_FLAG_* bits
+    uint64_t categories_offset;  // uint8_t[count], category used by promotions
+    uint64_t name_offsets_offset; // uint32_t[count], start of each name in the pool
+    uint64_t names_offset;       // char[names_size], NUL-terminated names
+    uint64_t id_keys_offset;     // int32_t[id_index_size], product id or -1 if the bucket is empty
+    uint64_t id_slots_offset;    // int32_t[id_index_size], slot of the bucket's product id
+    uint64_t name_index_offset;  // int32_t[name_index_size], slot or -1 if the bucket is empty
+    uint64_t total_size;         // Size of the whole block
+} catalog_header_t;
+
+/**
+ * A loaded catalog. The column pointers refer into the catalog block and
+ * are indexed by slot.
+ */
+typedef struct catalog_t {
+    int count;                   // Number of products
+    const int32_t* ids;          // Product id
+    const int32_t* prices;       // Price in cents
+    const int32_t* stock;        // Base stock, before scaling by the customer count
+    const int32_t* prep_costs;   // Assistant preparation cost
+    const uint8_t* flags;        // PRODUCT_FLAG_* bits
+    const uint8_t* categories;   // Category, 0 to MAX_CATEGORIES - 1
+    const uint32_t* name_offsets; // Start of each name in the string pool
+    const char* names;           // String pool of NUL-terminated names
+    const int32_t* id_keys;      // Open-addressing hash table of product ids, -1 for empty buckets
+    const int32_t* id_slots;     // Slot of the product id in the same bucket of id_keys
+    int id_index_size;           // Number of id buckets, a power of two
+    const int32_t* name_index;   // Open-addressing hash table of slots by name
+    int name_index_size;         // Number of buckets, a power of two
+    void* block;                 // Start of the catalog block
+    size_t block_size;           // Size of the catalog block
+    int mapped;                  // Whether the block is a file mapping or heap memory
+} catalog_t;
+
+/**
+ * Builds a catalog in memory from an array of products.
+ * Exits the program if the products have negative or duplicate ids,
+ * negative prices, stock or prep costs, or categories out of range.
+ *
+ * @param catalog Catalog to fill in
+ * @param products Products in slot order, copied into the catalog's columns
+ * @param count Number of products
+ */
+void catalog_build(catalog_t* catalog, const product_t* products, int count);
+
+/**
+ * Loads a catalog from a binary catalog file or a CSV file, depending on
+ * whether the file starts with CATALOG_MAGIC.
+ * Exits the program if the file cannot be read or is malformed.
+ *
+ * @param catalog Catalog to fill in
+ * @param path Path of the catalog file
+ */
+void catalog_load(catalog_t* catalog, const char* path);
+
+/**
+ * Converts a CSV catalog into a binary catalog file.
+ * Exits the program on any error.
+ *
+ * @param csv_path Path of the CSV catalog to read
+ * @param binary_path Path of the binary catalog to write
+ * @return Number of products written
+ */
+int catalog_compile(const char* csv_path, const char* binary_path);
+
+/**
+ * Hashes a product id into the id index, before masking to its size.
+ */
+static inline uint32_t catalog_hash_id(int product_id) {
+    uint32_t hash = (uint32_t)product_id * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * Gets the slot of a product.
+ *
+ * @param catalog Catalog to search
+ * @param product_id ID of the product
+ * @return Slot of the product, -1 if there is no product with that id
+ */
+static inline int catalog_slot(const catalog_t* catalog, int product_id) {
+    if (product_id < 0) {
+        return -1;
+    }
+    // Linear probing, the index always has empty buckets to stop at
+    uint32_t mask = catalog->id_index_size - 1;
+    uint32_t bucket = catalog_hash_id(product_id) & mask;
+    while (catalog->id_keys[bucket] != product_id) {
+        if (catalog->id_keys[bucket] == -1) {
+            return -1;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return catalog->id_slots[bucket];
+}
+
+/**
+ * Gets the name of a product.
+ *
+ * @param catalog Catalog holding the product
+ * @param slot Slot of the product
+ * @return Name of the product
+ */
+static inline const char* catalog_name(const catalog_t* catalog, int slot) {
+    return catalog->names + catalog->name_offsets[slot];
+}
+
+/**
+ * Finds a product by its exact name.
+ *
+ * @param catalog Catalog to search
+ * @param name Name of the product
+ * @return Slot of the product, -1 if there is no product with that name
+ */
+int catalog_find_by_name(const catalog_t* catalog, const char* name);
+
+/**
+ * Releases the catalog block.
+ *
+ * @param catalog Catalog to release
+ */
+void catalog_destroy(catalog_t* catalog);
+
+#endif /* CATALOG_H */
@@ -0,0 +1,129 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdbool.h>
+
+#include "transaction.h"
+#include "spinpark.h"
+
+/**
+ * Channel Module
+ *
+ * This module implements the checkout protocol between a customer and the
+ * clerk serving them as typed messages on a pair of single-producer,
+ * single-consumer ring buffers. Neither side holds a lock while the other
+ * one works, and the protocol does not depend on who runs each side, so it
+ * can be driven by threads, coroutines or an event loop alike.
+ *
+ * A checkout runs as follows:
+ *   customer -> clerk     MSG_ITEM_REQUEST (once per item on the list)
+ *   clerk    -> customer  MSG_ITEM_RESPONSE (answer to each request)
+ *   customer -> clerk     MSG_DONE (no more items)
+ *   clerk    -> customer  MSG_RECEIPT
+ *   customer -> clerk     MSG_PAYMENT
+ *   clerk    -> customer  MSG_DONE (clerk no longer touches the receipt)
+ */
+
+/** Number of messages a channel direction can hold, must be a power of two */
+#define CHANNEL_CAPACITY 8
+
+/** Size of a cache line, used to keep producer and consumer indices apart */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Types of checkout messages.
+ */
+typedef enum checkout_msg_type_t {
+    MSG_ITEM_REQUEST,        // Customer asks for a product
+    MSG_ITEM_RESPONSE,       // Clerk answers an item request
+    MSG_RECEIPT,             // Clerk hands over the finished transaction
+    MSG_PAYMENT,             // Customer pays the receipt
+    MSG_DONE                 // Sender has finished its part of the checkout
+} checkout_msg_type_t;
+
+/**
+ * A single checkout message.
+ */
+typedef struct checkout_msg_t {
+    checkout_msg_type_t type; // Kind of message
+    int product_id;           // Requested or answered product (item messages)
+    bool in_stock;            // Whether the item was sold (MSG_ITEM_RESPONSE)
+    transaction_t* receipt;   // Finished transaction (MSG_RECEIPT)
+    int amount;               // Amount paid in cents (MSG_PAYMENT)
+} checkout_msg_t;
+
+/**
+ * One direction of a checkout channel: a bounded SPSC ring buffer.
+ */
+typedef struct channel_t {
+    checkout_msg_t slots[CHANNEL_CAPACITY]; // Message storage
+    unsigned int head;                     // Next slot to read, written by the consumer
+    char head_pad[CACHE_LINE_SIZE - sizeof(unsigned int)];
+    unsigned int tail;                     // Next slot to write, written by the producer
+    char tail_pad[CACHE_LINE_SIZE - sizeof(unsigned int)];
+    spin_park_t wait;                      // Wait point for an empty or full ring
+} channel_t;
+
+/**
+ * Both directions of the channel between a customer and a clerk.
+ */
+typedef struct checkout_channel_t {
+    channel_t to_clerk;      // Messages from the customer to the clerk
+    channel_t to_customer;   // Messages from the clerk to the customer
+} checkout_channel_t;
+
+/**
+ * Initializes both directions of a checkout channel.
+ *
+ * @param ch Pointer to the checkout channel
+ */
+void checkout_channel_init(checkout_channel_t* ch);
+
+/**
+ * Sends a message without blocking.
+ *
+ * @param c Channel direction to send on
+ * @param msg Message to send
+ * @return true if the message was sent, false if the channel is full
+ */
+bool channel_try_send(channel_t* c, const checkout_msg_t* msg);
+
+/**
+ * Sends a message, waiting while the channel is full.
+ *
+ * @param c Channel direction to send on
+ * @param msg Message to send
+ * @param budget Spin budget of the calling thread
+ */
+void channel_send(channel_t* c, const checkout_msg_t* msg, spin_budget_t* budget);
+
+/**
+ * Receives a message without blocking.
+ *
+ * @param c Channel direction to receive from
+ * @param msg Filled with the received message
+ * @return true if a message was received, false if the channel is empty
+ */
+bool channel_try_recv(channel_t* c, checkout_msg_t* msg);
+
+/**
+ * Receives a message, waiting while the channel is empty.
+ *
+ * @param c Channel direction to receive from
+ * @param msg Filled with the received message
+ * @param budget Spin budget of the calling thread
+ */
+void channel_recv(channel_t* c, checkout_msg_t* msg, spin_budget_t* budget);
+
+/**
+ * Receives a message, waiting while the channel is empty until a deadline.
+ *
+ * @param c Channel direction to receive from
+ * @param msg Filled with the received message
+ * @param budget Spin budget of the calling thread
+ * @param deadline_ns Time on the now_ns() clock to give up at
+ * @return true if a message was received, false if the deadline passed first
+ */
+bool channel_recv_until(channel_t* c, checkout_msg_t* msg, spin_budget_t* budget, long long deadline_ns);
+
+#endif /* CHANNEL_H */
@@ -9,10 +9,10 @@
 
 #include "transaction.h"
 #include "customer.h"
-#include "queue.h"
 #include "parameters.h"
 #include "product.h"
 #include "assistant.h"
+#include "coroutine.h"
 
 /**
  * Clerk Module
@@ -24,12 +24,41 @@
  * 3. Requests assistant help for special products
  * 4. Provides a receipt to the customer
  * 5. Collects payment
+ *
+ * With CLERK_MAX_INFLIGHT above 1 a clerk serves each customer in a
+ * coroutine of its own. When a customer's basket waits for the assistant,
+ * the clerk takes the next customer from its queue instead of blocking,
+ * and comes back to the first one once its jobs are done. Handshakes with
+ * the customer still block the clerk, they are short compared to the
+ * assistant's work.
+ *
+ * With CLERK_PIPELINE_DEPTH above 1 each lane is a two-stage pipeline: the
+ * clerk scans the items of the next customer while a cashier thread waits
+ * for the assistant jobs of the previous ones, hands out their receipts
+ * and takes their payments, in the order they were scanned.
  */
 
 /**
  * Array of queues, one per clerk. Each queue contains waiting customers.
  */
-extern queue* clerk_queues[NUM_CLERKS];
+extern customer_queue_t* clerk_queues[NUM_CLERKS];
+
+/** Customer slots of a clerk, enough for coroutines or the checkout pipeline */
+#define CLERK_SLOTS (CLERK_MAX_INFLIGHT > CLERK_PIPELINE_DEPTH ? CLERK_MAX_INFLIGHT : CLERK_PIPELINE_DEPTH)
+
+/**
+ * A customer a clerk is serving.
+ */
+typedef struct clerk_slot_t {
+    int index;               // Position in the clerk's slots, stored in assistant jobs
+    customer_t* customer;    // Customer being served, NULL when the slot is free
+    int pending_jobs;        // Count of pending assistant jobs
+    long long jobs_since_ns; // Time the oldest pending assistant job was submitted
+    struct clerk_t* clerk;   // Clerk owning the slot
+    coroutine_t coroutine;   // Serves the customer (CLERK_MAX_INFLIGHT > 1 only)
+    transaction_t* transaction; // Scanned basket waiting for the cashier (CLERK_PIPELINE_DEPTH > 1 only)
+    int delivered_jobs;      // Jobs back from the assistant, counted by the cashier (CLERK_PIPELINE_DEPTH > 1 only)
+} clerk_slot_t;
 
 /**
  * Represents a clerk in the shop.
@@ -37,17 +66,39 @@ extern queue* clerk_queues[NUM_CLERKS];
 typedef struct clerk_t {
     int id;                  // Unique ID for the clerk
     int cash_register;       // Amount of money collected
-    queue* customer_queue;   // Queue of customers waiting for this clerk
-    int pending_jobs;        // Count of pending assistant jobs
+    customer_queue_t* customer_queue; // Queue of customers waiting for this clerk
+    clerk_slot_t slots[CLERK_SLOTS]; // Customers being served
+    spin_budget_t spin_budget; // Adaptive spin budget for customer handshakes
+
+    /* Checkout pipeline (CLERK_PIPELINE_DEPTH > 1 only) */
+    pthread_mutex_t pipeline_mutex; // Protects the counters below
+    pthread_cond_t pipeline_cond;   // Signaled when a customer moves between stages
+    int accepted;            // Customers the clerk has started scanning
+    int scanned;             // Customers handed to the cashier
+    int paid;                // Customers the cashier has finished
+    bool closing;            // Set once the clerk's queue is closed and drained
+    spin_budget_t cashier_spin_budget; // Adaptive spin budget of the cashier thread
 } clerk_t;
 
 /**
  * Main function for the clerk thread.
- * Processes customers from the queue until receiving a SENTINEL_VALUE.
+ * Processes customers from the queue until it is closed and drained.
  * 
  * @param arg Pointer to a clerk_t structure
  * @return Always returns NULL
  */
 void* clerk_thread(void* arg);
 
+/**
+ * Clears the clerk statistics. Must be called before the clerks start.
+ */
+void clerk_report_reset();
+
+/**
+ * Prints how many customers clerks served at the same time, in coroutines
+ * or in the checkout pipeline, and how long they were blocked waiting for
+ * the assistant.
+ */
+void clerk_report();
+
 #endif /* CLERK_H */
@@ -0,0 +1,91 @@
+#ifndef CLERKPOOL_H
+#define CLERKPOOL_H
+
+#include <stdbool.h>
+#include "parameters.h"
+
+/**
+ * Clerk Pool Module
+ *
+ * This module decides which clerk lanes are open. Every clerk thread runs
+ * for the whole simulation, but customers only join open lanes. With
+ * CLERK_POOL_ELASTIC a manager thread looks at the queues every
+ * CLERK_POOL_INTERVAL_US and:
+ *   - opens a lane when the open lanes average CLERK_OPEN_QUEUE_LENGTH
+ *     waiting customers, or a customer waited CLERK_OPEN_WAIT_US,
+ *   - closes a lane after CLERK_CLOSE_INTERVALS intervals with at most
+ *     CLERK_CLOSE_QUEUE_LENGTH waiting customers per open lane.
+ * A closing lane takes no new customers but its clerk serves everyone
+ * already in its queue; the lane counts as staffed until that queue is
+ * empty and the clerk is idle. A clerk whose lane is closed sleeps in its
+ * queue, so it costs nothing until the lane opens again.
+ *
+ * The last NUM_EXPRESS_LANES lanes are express lanes, only joined by
+ * customers with at most EXPRESS_MAX_ITEMS items and no assistant products.
+ * Express lanes are closed first, regular lanes 0 to MIN_OPEN_CLERKS - 1
+ * always stay open.
+ *
+ * Staffing is reported as clerk-seconds, the time lanes were staffed, so
+ * runs with different pool settings can be compared on cost and latency.
+ */
+
+/**
+ * Opens the starting lanes and, with CLERK_POOL_ELASTIC, starts the
+ * manager thread. Must be called after the clerk queues are created.
+ */
+void clerk_pool_start();
+
+/**
+ * Stops the manager thread and closes the staffing accounts.
+ */
+void clerk_pool_stop();
+
+/**
+ * Tells whether customers may join a lane.
+ *
+ * @param lane Clerk ID of the lane
+ * @return true if the lane is open
+ */
+bool clerk_pool_lane_open(int lane);
+
+/**
+ * Tells whether a lane only takes small baskets.
+ *
+ * @param lane Clerk ID of the lane
+ * @return true if the lane is an express lane
+ */
+bool clerk_pool_lane_express(int lane);
+
+/**
+ * Counts where a customer was routed. Thread-safe.
+ *
+ * @param express_basket Whether the customer may use express lanes
+ * @param lane Clerk ID of the lane the customer joined
+ */
+void clerk_pool_record_route(bool express_basket, int lane);
+
+/**
+ * Marks a clerk as serving a customer or idle.
+ * Lanes being closed stay staffed until their clerk is idle.
+ *
+ * @param lane Clerk ID of the lane
+ * @param busy true when the clerk starts serving a customer, false when it is done
+ */
+void clerk_pool_set_busy(int lane, bool busy);
+
+/**
+ * Reports how long a customer waited in a clerk queue. Thread-safe.
+ *
+ * @param wait_ns Time from joining the queue to being picked by a clerk, in nanoseconds
+ */
+void clerk_pool_record_wait(long long wait_ns);
+
+/**
+ * Prints the clerk-seconds used, lane changes and customers served per
+ * clerk-second, and how customers used the express lanes.
+ *
+ * @param customers_served Customers served during the simulation
+ */
+void clerk_pool_report(int customers_served);
+
+#endif /* CLERKPOOL_H */
@@ -0,0 +1,75 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <ucontext.h>
+
+/**
+ * Coroutine Module
+ *
+ * This module provides stackful coroutines on top of ucontext. A thread
+ * resumes a coroutine, which runs on its own stack until it yields or
+ * returns, and control then comes back to the resume call. Coroutines are
+ * never shared between threads and must not yield while holding a lock.
+ */
+
+/**
+ * Body of a coroutine.
+ */
+typedef void (*coroutine_fn)(void* arg);
+
+/**
+ * A stackful coroutine.
+ */
+typedef struct coroutine_t {
+    ucontext_t context;      // Saved state of the coroutine
+    ucontext_t caller;       // Saved state of the thread that resumed it
+    void* stack;             // Stack of the coroutine
+    size_t stack_size;       // Size of the stack in bytes
+    coroutine_fn fn;         // Body, called once
+    void* arg;               // Argument of the body
+    bool finished;           // True once the body has returned
+} coroutine_t;
+
+/**
+ * Allocates the stack of a coroutine. The coroutine can then be started
+ * any number of times, one after the other.
+ *
+ * @param co Coroutine to initialize
+ * @param stack_size Size of its stack in bytes
+ */
+void coroutine_init(coroutine_t* co, size_t stack_size);
+
+/**
+ * Prepares a coroutine to run a body from the start. The body only runs
+ * on the next coroutine_resume().
+ *
+ * @param co Coroutine that is not started or has finished
+ * @param fn Body of the coroutine
+ * @param arg Argument of the body
+ */
+void coroutine_start(coroutine_t* co, coroutine_fn fn, void* arg);
+
+/**
+ * Runs a coroutine until it yields or its body returns.
+ *
+ * @param co Started coroutine that has not finished
+ * @return true if the body returned, false if the coroutine yielded
+ */
+bool coroutine_resume(coroutine_t* co);
+
+/**
+ * Suspends the calling coroutine, returning control to coroutine_resume().
+ * Must be called from inside a coroutine.
+ */
+void coroutine_yield();
+
+/**
+ * Frees the stack of a coroutine.
+ *
+ * @param co Coroutine that is not running
+ */
+void coroutine_destroy(coroutine_t* co);
+
+#endif /* COROUTINE_H */
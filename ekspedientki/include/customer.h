@@ -3,6 +3,9 @@
 
 #include <pthread.h>
 #include "transaction.h"
+#include "channel.h"
+#include "pricing.h"
+#include "iqueue.h"
 #include <stdbool.h>
 
 /**
@@ -13,6 +16,16 @@
  * a purchase transaction with a clerk.
  */
 
+/**
+ * How a customer's visit ended.
+ */
+typedef enum customer_outcome_t {
+    CUSTOMER_SERVED,             // Paid and left with a receipt
+    CUSTOMER_ABANDONED,          // Ran out of patience in a clerk queue
+    CUSTOMER_BALKED,             // Saw a long queue and left without joining
+    NUM_CUSTOMER_OUTCOMES
+} customer_outcome_t;
+
 /**
  * Represents a customer shopping in the store.
  */
@@ -21,20 +34,26 @@ typedef struct customer_t {
     int wallet;                  // Customer's money in cents
     int* shopping_list;          // Array of product IDs to purchase
     int shopping_list_size;      // Number of items in shopping list
+    int coupon;                  // Coupon presented at checkout, NO_COUPON for none
+    long long arrival_ns;        // Scheduled arrival time, latency is measured from here
+    long long queued_ns;         // Time the customer joined a clerk queue
+    long long patience_deadline_ns; // Time the customer gives up waiting, LLONG_MAX for never
+    customer_outcome_t outcome;  // How the visit ended
 
     transaction_t* receipt;      // Transaction receipt from clerk
+    bool transaction_complete;   // True once the clerk is completely done
 
-    pthread_cond_t cond;         // Condition variable for synchronization
-    pthread_mutex_t mutex;       // Mutex for thread safety
-
-    // Fields for item-by-item processing
-    int current_item_index;      // Index of current item being processed
-    int current_item;            // Current product ID being requested
-    bool waiting_for_response;   // True when waiting for clerk to process an item
-    bool clerk_ready;            // True when a clerk is ready to serve this customer
-    volatile int transaction_complete;  // Flag to indicate the clerk is completely done
+    checkout_channel_t checkout; // Message channel to and from the serving clerk
+    spin_budget_t spin_budget;   // Adaptive spin budget of the customer thread
+    struct customer_t* queue_next; // Next customer in the clerk or kiosk queue
 } customer_t;
 
+/**
+ * Intrusive queue of customers, linked through queue_next, for the clerk
+ * and kiosk queues. See iqueue.h for its functions.
+ */
+IQUEUE_DECLARE(customer_queue, customer_t);
+
 /**
  * Main function for the customer thread.
  * Implements the customer's shopping behavior.
@@ -0,0 +1,242 @@
+#ifndef IQUEUE_H
+#define IQUEUE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Intrusive Queue Module
+ *
+ * This module generates thread-safe FIFO queues whose link lives in the
+ * queued element itself, so pushing allocates nothing and popping returns
+ * the element without going through a node. Each element type gets a
+ * queue type and functions of its own, with no void* casts:
+ *
+ *   IQUEUE_DECLARE(name, type) in a header declares the queue type name_t
+ *   and the functions below for elements of type type.
+ *   IQUEUE_DEFINE(name, type, link) in one source file defines them, where
+ *   link is the member of type that holds the next element (type* link).
+ *
+ * An element is in at most one queue of its type at a time. Queues do not
+ * take a SENTINEL_VALUE; they are closed instead, and consumers take the
+ * elements left before being told the queue is drained.
+ *
+ * Generated functions:
+ *   name_t* name_create()                      New empty queue
+ *   void name_destroy(name_t* q)               Frees the queue, not its elements
+ *   void name_push(name_t* q, type* e)         Appends an element
+ *   type* name_pop(name_t* q)                  Takes the first element, blocking while
+ *                                              the queue is empty; NULL once closed and drained
+ *   type* name_try_pop(name_t* q)              Takes the first element, NULL if empty
+ *   bool name_remove(name_t* q, type* e)       Removes an element from anywhere in the
+ *                                              queue, false if it is not queued
+ *   void name_close(name_t* q)                 Closes the queue and wakes every consumer
+ *   bool name_drained(name_t* q)               True once the queue is closed and empty
+ *   int name_size(name_t* q)                   Number of queued elements
+ *   int name_size_approx(name_t* q)            Same without taking the lock, see queue_size_approx()
+ *   int name_event_fd(name_t* q)               eventfd readable after pushes and on close,
+ *                                              see queue_event_fd()
+ *   void name_event_clear(name_t* q)           Resets the eventfd, see queue_event_clear()
+ */
+
+/**
+ * Lock, wake-up and bookkeeping shared by every intrusive queue type.
+ */
+typedef struct iqueue_state_t {
+    pthread_mutex_t lock;    // Mutex for thread safety
+    pthread_cond_t cond;     // Condition variable for signaling
+    int size;                // Number of queued elements, written with the lock held
+    bool closed;             // Set by close, consumers stop once the queue is empty
+    int event_fd;            // eventfd written on every push, -1 until first requested
+} iqueue_state_t;
+
+/**
+ * Initializes the shared state of a new queue.
+ */
+void iqueue_state_init(iqueue_state_t* state);
+
+/**
+ * Releases the shared state of a queue, closing its eventfd.
+ */
+void iqueue_state_destroy(iqueue_state_t* state);
+
+/**
+ * Publishes a new size for the approximate reads. Must be called with the lock held.
+ */
+void iqueue_state_set_size(iqueue_state_t* state, int size);
+
+/**
+ * Marks the queue closed and wakes every consumer, blocked or on the eventfd.
+ */
+void iqueue_state_close(iqueue_state_t* state);
+
+/**
+ * Gets the number of queued elements, taking the lock.
+ */
+int iqueue_state_size(iqueue_state_t* state);
+
+/**
+ * Gets the number of queued elements without taking the lock.
+ */
+int iqueue_state_size_approx(iqueue_state_t* state);
+
+/**
+ * Gets the eventfd of a queue, creating it readable if elements are queued
+ * or the queue is closed.
+ */
+int iqueue_state_event_fd(iqueue_state_t* state);
+
+/**
+ * Writes to an eventfd after a push, does nothing for -1. Called without the lock.
+ */
+void iqueue_notify(int event_fd);
+
+/**
+ * Resets an eventfd so it is not readable until the next push.
+ */
+void iqueue_event_clear(int event_fd);
+
+/**
+ * Declares an intrusive queue type name_t of elements of type and its functions.
+ */
+#define IQUEUE_DECLARE(name, type)                                              \
+    typedef struct name##_t {                                                   \
+        type* head;              /* First queued element */                     \
+        type* tail;              /* Last queued element */                      \
+        iqueue_state_t state;    /* Lock, size, close flag and eventfd */       \
+    } name##_t;                                                                 \
+                                                                                \
+    name##_t* name##_create();                                                  \
+    void name##_destroy(name##_t* q);                                           \
+    void name##_push(name##_t* q, type* element);                               \
+    type* name##_pop(name##_t* q);                                              \
+    type* name##_try_pop(name##_t* q);                                          \
+    bool name##_remove(name##_t* q, type* element);                             \
+    void name##_close(name##_t* q);                                             \
+    bool name##_drained(name##_t* q);                                           \
+    int name##_size(name##_t* q);                                               \
+    int name##_size_approx(name##_t* q);                                        \
+    int name##_event_fd(name##_t* q);                                           \
+    void name##_event_clear(name##_t* q)
+
+/**
+ * Defines the functions of an intrusive queue declared with IQUEUE_DECLARE,
+ * linking elements through their link member.
+ */
+#define IQUEUE_DEFINE(name, type, link)                                         \
+    name##_t* name##_create() {                                                 \
+        name##_t* q = malloc(sizeof(name##_t));                                 \
+        if (q == NULL) {                                                        \
+            fprintf(stderr, "Error: malloc failed\n");                          \
+            exit(1);                                                            \
+        }                                                                       \
+        q->head = NULL;                                                         \
+        q->tail = NULL;                                                         \
+        iqueue_state_init(&q->state);                                           \
+        return q;                                                               \
+    }                                                                           \
+                                                                                \
+    void name##_destroy(name##_t* q) {                                          \
+        iqueue_state_destroy(&q->state);                                        \
+        free(q);                                                                \
+    }                                                                           \
+                                                                                \
+    /* Unlinks the first element, the lock is held and the queue not empty */   \
+    static type* name##_unlink_head(name##_t* q) {                              \
+        type* element = q->head;                                                \
+        q->head = element->link;                                                \
+        if (q->head == NULL) {                                                  \
+            q->tail = NULL;                                                     \
+        }                                                                       \
+        element->link = NULL;                                                   \
+        iqueue_state_set_size(&q->state, q->state.size - 1);                    \
+        return element;                                                         \
+    }                                                                           \
+                                                                                \
+    void name##_push(name##_t* q, type* element) {                              \
+        element->link = NULL;                                                   \
+        pthread_mutex_lock(&q->state.lock);                                     \
+        if (q->tail != NULL) {                                                  \
+            q->tail->link = element;                                            \
+        } else {                                                                \
+            q->head = element;                                                  \
+        }                                                                       \
+        q->tail = element;                                                      \
+        iqueue_state_set_size(&q->state, q->state.size + 1);                    \
+        pthread_cond_signal(&q->state.cond);                                    \
+        int event_fd = q->state.event_fd;                                       \
+        pthread_mutex_unlock(&q->state.lock);                                   \
+        iqueue_notify(event_fd);                                                \
+    }                                                                           \
+                                                                                \
+    type* name##_pop(name##_t* q) {                                             \
+        pthread_mutex_lock(&q->state.lock);                                     \
+        while (q->head == NULL && !q->state.closed) {                           \
+            pthread_cond_wait(&q->state.cond, &q->state.lock);                  \
+        }                                                                       \
+        type* element = q->head != NULL ? name##_unlink_head(q) : NULL;         \
+        pthread_mutex_unlock(&q->state.lock);                                   \
+        return element;                                                         \
+    }                                                                           \
+                                                                                \
+    type* name##_try_pop(name##_t* q) {                                         \
+        pthread_mutex_lock(&q->state.lock);                                     \
+        type* element = q->head != NULL ? name##_unlink_head(q) : NULL;         \
+        pthread_mutex_unlock(&q->state.lock);                                   \
+        return element;                                                         \
+    }                                                                           \
+                                                                                \
+    bool name##_remove(name##_t* q, type* element) {                            \
+        pthread_mutex_lock(&q->state.lock);                                     \
+        type* previous = NULL;                                                  \
+        type* current = q->head;                                                \
+        while (current != NULL && current != element) {                         \
+            previous = current;                                                 \
+            current = current->link;                                            \
+        }                                                                       \
+        if (current != NULL) {                                                  \
+            if (previous != NULL) {                                             \
+                previous->link = current->link;                                 \
+            } else {                                                            \
+                q->head = current->link;                                        \
+            }                                                                   \
+            if (q->tail == current) {                                           \
+                q->tail = previous;                                             \
+            }                                                                   \
+            current->link = NULL;                                               \
+            iqueue_state_set_size(&q->state, q->state.size - 1);                \
+        }                                                                       \
+        pthread_mutex_unlock(&q->state.lock);                                   \
+        return current != NULL;                                                 \
+    }                                                                           \
+                                                                                \
+    void name##_close(name##_t* q) {                                            \
+        iqueue_state_close(&q->state);                                          \
+    }                                                                           \
+                                                                                \
+    bool name##_drained(name##_t* q) {                                          \
+        pthread_mutex_lock(&q->state.lock);                                     \
+        bool drained = q->state.closed && q->head == NULL;                      \
+        pthread_mutex_unlock(&q->state.lock);                                   \
+        return drained;                                                         \
+    }                                                                           \
+                                                                                \
+    int name##_size(name##_t* q) {                                              \
+        return iqueue_state_size(&q->state);                                    \
+    }                                                                           \
+                                                                                \
+    int name##_size_approx(name##_t* q) {                                       \
+        return iqueue_state_size_approx(&q->state);                             \
+    }                                                                           \
+                                                                                \
+    int name##_event_fd(name##_t* q) {                                          \
+        return iqueue_state_event_fd(&q->state);                                \
+    }                                                                           \
+                                                                                \
+    void name##_event_clear(name##_t* q) {                                      \
+        iqueue_event_clear(q->state.event_fd);                                  \
+    }
+
+#endif /* IQUEUE_H */
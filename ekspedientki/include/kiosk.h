@@ -0,0 +1,49 @@
+#ifndef KIOSK_H
+#define KIOSK_H
+
+#include <stdbool.h>
+#include "customer.h"
+#include "parameters.h"
+
+/**
+ * Kiosk Module
+ *
+ * This module runs the self-checkout kiosks. Customers with at most
+ * KIOSK_MAX_ITEMS items skip the clerks: they put their whole basket in a
+ * transaction of their own and join the kiosk queue, which NUM_KIOSKS
+ * worker threads share. A kiosk worker:
+ * 1. Takes the next customer from the kiosk queue
+ * 2. Reserves the whole basket from its own stock shard in one call
+ * 3. Sends assistant products to the assistant and waits for them
+ * 4. Prices the basket and hands back the receipt
+ * 5. Collects payment
+ *
+ * There is no item-by-item exchange with the customer, so a kiosk costs
+ * two round trips per customer where a clerk costs one per item.
+ * Kiosk worker k uses stock shard and inbox NUM_CLERKS + k.
+ */
+
+/**
+ * Queue of customers waiting for a kiosk, NULL without kiosks.
+ */
+extern customer_queue_t* kiosk_queue;
+
+/**
+ * Creates the kiosk queue and starts the kiosk workers. Does nothing
+ * when NUM_KIOSKS is 0. Must be called after the clerk inboxes are
+ * initialized.
+ */
+void kiosks_start();
+
+/**
+ * Stops the kiosk workers, which deposit their earnings to the safe, and
+ * frees the kiosk queue. Must be called after every customer has left.
+ */
+void kiosks_stop();
+
+/**
+ * Prints the self-checkout statistics, nothing when NUM_KIOSKS is 0.
+ */
+void kiosk_report();
+
+#endif /* KIOSK_H */
@@ -0,0 +1,84 @@
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+#include <pthread.h>
+#include "parameters.h"
+
+/**
+ * Lock Profiling Module
+ *
+ * When ENABLE_LOCK_PROFILING is set, including this header after the other
+ * headers of a source file replaces its pthread_mutex_lock(),
+ * pthread_mutex_unlock(), pthread_cond_wait() and pthread_cond_timedwait()
+ * calls with instrumented versions. Each lock is identified by the expression passed to the call:
+ * globals by their name (printf_mutex), struct members by the file and
+ * member (queue.lock), so every queue's lock adds up under one name.
+ *
+ * For every named lock the profiler counts acquisitions and contended
+ * acquisitions (the lock was already held), and keeps power-of-two
+ * histograms of the time spent waiting for the lock and the time it was
+ * held. Time a thread spends waiting on a condition variable does not count as
+ * holding the lock. With ENABLE_LOCK_PROFILING set to 0 the calls are left
+ * untouched and cost nothing.
+ */
+
+/**
+ * Statistics of one named lock.
+ */
+typedef struct lock_stats_t lock_stats_t;
+
+/**
+ * Finds or adds the statistics of a lock.
+ *
+ * @param expression Lock expression as written at the call site
+ * @param file Source file of the call site
+ * @return Statistics shared by every call site naming the same lock
+ */
+lock_stats_t* lockprof_site(const char* expression, const char* file);
+
+/**
+ * Locks a mutex, recording the wait.
+ */
+int lockprof_lock(pthread_mutex_t* mutex, lock_stats_t* stats);
+
+/**
+ * Unlocks a mutex, recording how long it was held.
+ */
+int lockprof_unlock(pthread_mutex_t* mutex);
+
+/**
+ * Waits on a condition variable, pausing the hold time of its mutex.
+ */
+int lockprof_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+
+/**
+ * Waits on a condition variable with a deadline, pausing the hold time of its mutex.
+ */
+int lockprof_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                            const struct timespec* deadline);
+
+/**
+ * Clears the statistics of every lock for a new simulation.
+ */
+void lockprof_reset();
+
+/**
+ * Prints the locks ranked by total wait time.
+ */
+void lockprof_report();
+
+#if ENABLE_LOCK_PROFILING
+/* Each call site resolves its lock name once */
+#define pthread_mutex_lock(mutex) ({                                        \
+    static lock_stats_t* lockprof_stats_;                                   \
+    if (__builtin_expect(lockprof_stats_ == NULL, 0)) {                     \
+        lockprof_stats_ = lockprof_site(#mutex, __FILE__);                  \
+    }                                                                       \
+    lockprof_lock((mutex), lockprof_stats_);                                \
+})
+#define pthread_mutex_unlock(mutex) lockprof_unlock(mutex)
+#define pthread_cond_wait(cond, mutex) lockprof_cond_wait((cond), (mutex))
+#define pthread_cond_timedwait(cond, mutex, deadline) lockprof_cond_timedwait((cond), (mutex), (deadline))
+#endif
+
+#endif /* LOCKPROF_H */
@@ -0,0 +1,118 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+
+#include "parameters.h"
+
+/**
+ * Metrics Module
+ *
+ * This module keeps a registry of live metrics and serves snapshots of it
+ * in the Prometheus text format over a Unix domain socket, so long runs can
+ * be watched while they happen:
+ *   socat - UNIX-CONNECT:/tmp/ekspedientki.sock
+ *   curl --unix-socket /tmp/ekspedientki.sock http://localhost/metrics
+ *
+ * Counters are sharded: each thread adds to its own cache-line sized slot
+ * and a snapshot sums the slots, so counting on a hot path costs one
+ * uncontended atomic add. Gauges are read by callbacks when a snapshot is
+ * taken and cost nothing in between. With ENABLE_METRICS set to 0 the
+ * counter updates compile away and no exporter thread is started.
+ */
+
+/** Number of slots each counter is split into, a power of two */
+#define METRICS_SHARDS 16
+
+/** Most metrics the registry holds */
+#define MAX_METRICS 32
+
+/** Size of a cache line, keeps counter slots of different threads apart */
+#define METRICS_CACHE_LINE 64
+
+/**
+ * A sharded counter.
+ */
+typedef struct metrics_counter_t {
+    struct {
+        long value;
+        char pad[METRICS_CACHE_LINE - sizeof(long)];
+    } shards[METRICS_SHARDS];
+} metrics_counter_t;
+
+/**
+ * Reads one instance of a gauge.
+ *
+ * @param index Instance to read, 0 to the number of instances - 1
+ * @return Current value
+ */
+typedef double (*metrics_gauge_fn)(int index);
+
+/**
+ * Clears the registry. Call before registering the metrics of a simulation.
+ */
+void metrics_reset();
+
+/**
+ * Registers a counter.
+ *
+ * @param counter Counter to register, zeroed by this call
+ * @param name Metric name
+ * @param help Description shown in the snapshot
+ */
+void metrics_register_counter(metrics_counter_t* counter, const char* name, const char* help);
+
+/**
+ * Registers a gauge with one or more instances. With more than one
+ * instance every value is labelled with its index.
+ *
+ * @param name Metric name
+ * @param help Description shown in the snapshot
+ * @param read Callback reading an instance
+ * @param instances Number of instances
+ * @param label Label name of the instance index, ignored for one instance
+ */
+void metrics_register_gauge(const char* name, const char* help, metrics_gauge_fn read,
+                            int instances, const char* label);
+
+/**
+ * Gets the counter slot of the calling thread, assigned on first use.
+ */
+int metrics_shard();
+
+/**
+ * Adds to a counter.
+ *
+ * @param counter Counter to add to
+ * @param amount Amount to add
+ */
+static inline void metrics_add(metrics_counter_t* counter, long amount) {
+    #if ENABLE_METRICS
+    __atomic_fetch_add(&counter->shards[metrics_shard()].value, amount, __ATOMIC_RELAXED);
+    #else
+    (void)counter;
+    (void)amount;
+    #endif
+}
+
+/**
+ * Writes a snapshot of every registered metric in Prometheus text format.
+ *
+ * @param buffer Buffer to write to
+ * @param size Size of the buffer
+ * @return Number of characters written, without the terminating NUL
+ */
+int metrics_snapshot(char* buffer, int size);
+
+/**
+ * Starts the thread serving snapshots on METRICS_SOCKET_PATH.
+ * Does nothing when ENABLE_METRICS is 0.
+ */
+void metrics_exporter_start();
+
+/**
+ * Stops the exporter thread and removes the socket.
+ */
+void metrics_exporter_stop();
+
+#endif /* METRICS_H */
@@ -18,14 +18,215 @@
 #define NUM_CUSTOMERS 100 // Any positive integer, tested up to 10000
 #endif
 
+/** Maximum number of items on a shopping list */
+#ifndef MAX_SHOPPING_LIST_SIZE
+#define MAX_SHOPPING_LIST_SIZE 10 // Any positive integer
+#endif
+
 /* Maximum number of concurrent customers in the shop */
 #ifndef MAX_CONCURRENT_CUSTOMERS
 #define MAX_CONCURRENT_CUSTOMERS 50 // Any positive integer, larger values may not be compatible with your system
 #endif
 
-/** Number of clerks serving customers */
+/** Number of threads creating customers in parallel */
+#ifndef NUM_SPAWNERS
+#define NUM_SPAWNERS 1 // Any positive integer, more spawners help when MAX_CONCURRENT_CUSTOMERS is high
+#endif
+
+/** Admission modes for closed-loop arrivals */
+#define ADMISSION_STATIC   0 // At most MAX_CONCURRENT_CUSTOMERS customers in the shop
+#define ADMISSION_ADAPTIVE 1 // Start at MAX_CONCURRENT_CUSTOMERS, adjust to hold ADMISSION_TARGET_P99_US
+
+/** How many customers the closed-loop spawner lets into the shop */
+#ifndef ADMISSION_MODE
+#define ADMISSION_MODE ADMISSION_STATIC // One of the ADMISSION_* modes above
+#endif
+
+/** Target p99 of the time customers wait in a clerk queue, in microseconds (ADMISSION_ADAPTIVE only) */
+#ifndef ADMISSION_TARGET_P99_US
+#define ADMISSION_TARGET_P99_US 1000 // Any positive integer
+#endif
+
+/** Queue waits measured before each limit adjustment (ADMISSION_ADAPTIVE only) */
+#ifndef ADMISSION_WINDOW
+#define ADMISSION_WINDOW 32 // Any positive integer, larger windows react slower but give a steadier p99
+#endif
+
+/** Percentage the limit drops when the target is missed (ADMISSION_ADAPTIVE only) */
+#ifndef ADMISSION_DECREASE_PCT
+#define ADMISSION_DECREASE_PCT 25 // 1 to 99, the limit grows back by one customer per window
+#endif
+
+/** Bounds of the adaptive limit (ADMISSION_ADAPTIVE only) */
+#ifndef ADMISSION_MIN_LIMIT
+#define ADMISSION_MIN_LIMIT NUM_CLERKS // Any positive integer, fewer customers leave clerks idle
+#endif
+#ifndef ADMISSION_MAX_LIMIT
+#define ADMISSION_MAX_LIMIT (4 * MAX_CONCURRENT_CUSTOMERS) // At least MAX_CONCURRENT_CUSTOMERS
+#endif
+
+/** Arrival modes for the customer spawner */
+#define ARRIVAL_CLOSED_LOOP 0 // A new customer enters as soon as another one leaves
+#define ARRIVAL_CONSTANT    1 // Open loop, customers arrive at fixed intervals
+#define ARRIVAL_POISSON     2 // Open loop, exponentially distributed inter-arrival times
+#define ARRIVAL_BURSTY      3 // Open loop, Poisson arrivals during ON periods, none during OFF periods
+
+/** How customers arrive at the shop */
+#ifndef ARRIVAL_MODE
+#define ARRIVAL_MODE ARRIVAL_CLOSED_LOOP // One of the ARRIVAL_* modes above
+#endif
+
+/** Target average arrival rate in customers per second (open-loop modes only) */
+#ifndef ARRIVAL_RATE
+#define ARRIVAL_RATE 5000 // Any positive integer
+#endif
+
+/** Length of an ON period in microseconds (ARRIVAL_BURSTY only) */
+#ifndef BURST_ON_US
+#define BURST_ON_US 5000 // Any positive integer
+#endif
+
+/** Length of an OFF period in microseconds (ARRIVAL_BURSTY only) */
+#ifndef BURST_OFF_US
+#define BURST_OFF_US 5000 // Any non-negative integer
+#endif
+
+/** Seed for the arrival schedule, the same seed always gives the same schedule */
+#ifndef ARRIVAL_SEED
+#define ARRIVAL_SEED 12345
+#endif
+
+/** Mean patience of a customer in microseconds: a customer not served by then leaves the queue */
+#ifndef CUSTOMER_PATIENCE_US
+#define CUSTOMER_PATIENCE_US 0 // Any non-negative integer, 0 for customers who wait forever
+#endif
+
+/** Queue length at which an arriving customer leaves without joining */
+#ifndef BALK_QUEUE_LENGTH
+#define BALK_QUEUE_LENGTH 0 // Any non-negative integer, 0 for customers who always join
+#endif
+
+/** Number of clerks serving customers, the most lanes open with CLERK_POOL_ELASTIC */
 #ifndef NUM_CLERKS
-#define NUM_CLERKS 3  // Should be less than or equal to the number of concurent customers, tested up to 3
+#define NUM_CLERKS 3  // Should be less than or equal to the number of concurent customers, tested up to 6
+#endif
+
+/** Customers one clerk serves at the same time, switching to another while one waits for the assistant */
+#ifndef CLERK_MAX_INFLIGHT
+#define CLERK_MAX_INFLIGHT 1 // Any positive integer, 1 serves one customer at a time without coroutines
+#endif
+
+/** How a clerk serving several customers waits for work (CLERK_MAX_INFLIGHT > 1 only) */
+#define CLERK_WAIT_CONDVAR 0 // Block on the customer queue when idle, else on the inbox
+#define CLERK_WAIT_EPOLL   1 // Wait on the eventfds of the customer queue and the inbox together
+
+/** Wait mode of clerks serving several customers */
+#ifndef CLERK_WAIT_MODE
+#define CLERK_WAIT_MODE CLERK_WAIT_CONDVAR // One of the CLERK_WAIT_* modes above
+#endif
+
+/** Customers in a clerk's lane between scanning and payment, a cashier thread takes payment while the clerk scans */
+#ifndef CLERK_PIPELINE_DEPTH
+#define CLERK_PIPELINE_DEPTH 1 // Any positive integer, 1 for no pipeline, only with CLERK_MAX_INFLIGHT 1
+#endif
+
+/** Clerk pool modes */
+#define CLERK_POOL_FIXED   0 // All NUM_CLERKS lanes stay open for the whole run
+#define CLERK_POOL_ELASTIC 1 // Lanes open and close with queue depth and wait, up to NUM_CLERKS
+
+/** How many clerk lanes are open */
+#ifndef CLERK_POOL_MODE
+#define CLERK_POOL_MODE CLERK_POOL_FIXED // One of the CLERK_POOL_* modes above
+#endif
+
+/** Lanes that always stay open (CLERK_POOL_ELASTIC only) */
+#ifndef MIN_OPEN_CLERKS
+#define MIN_OPEN_CLERKS 1 // 1 to NUM_CLERKS, the run starts with this many lanes open
+#endif
+
+/** How often the pool manager looks at the queues, in microseconds (CLERK_POOL_ELASTIC only) */
+#ifndef CLERK_POOL_INTERVAL_US
+#define CLERK_POOL_INTERVAL_US 500 // Any positive integer
+#endif
+
+/** Average customers waiting per open lane at which another lane opens (CLERK_POOL_ELASTIC only) */
+#ifndef CLERK_OPEN_QUEUE_LENGTH
+#define CLERK_OPEN_QUEUE_LENGTH 4 // Any positive integer
+#endif
+
+/** Longest queue wait in microseconds at which another lane opens (CLERK_POOL_ELASTIC only) */
+#ifndef CLERK_OPEN_WAIT_US
+#define CLERK_OPEN_WAIT_US 2000 // Any positive integer
+#endif
+
+/** Average customers waiting per open lane at or below which a lane closes (CLERK_POOL_ELASTIC only) */
+#ifndef CLERK_CLOSE_QUEUE_LENGTH
+#define CLERK_CLOSE_QUEUE_LENGTH 1 // Less than CLERK_OPEN_QUEUE_LENGTH
+#endif
+
+/** Consecutive quiet intervals before a lane closes (CLERK_POOL_ELASTIC only) */
+#ifndef CLERK_CLOSE_INTERVALS
+#define CLERK_CLOSE_INTERVALS 4 // Any positive integer, more intervals close lanes more reluctantly
+#endif
+
+/** Lanes reserved for small baskets, the clerks with the highest IDs */
+#ifndef NUM_EXPRESS_LANES
+#define NUM_EXPRESS_LANES 0 // 0 to NUM_CLERKS - 1, 0 for no express lanes
+#endif
+
+/** Largest basket an express lane accepts, baskets with assistant products never qualify */
+#ifndef EXPRESS_MAX_ITEMS
+#define EXPRESS_MAX_ITEMS 3 // 1 to MAX_SHOPPING_LIST_SIZE
+#endif
+
+/** Self-checkout kiosk workers, each serves one customer at a time from a shared kiosk queue */
+#ifndef NUM_KIOSKS
+#define NUM_KIOSKS 0 // Any non-negative integer, 0 for no self-checkout
+#endif
+
+/** Largest basket customers take to a self-checkout kiosk instead of a clerk (NUM_KIOSKS > 0 only) */
+#ifndef KIOSK_MAX_ITEMS
+#define KIOSK_MAX_ITEMS 3 // 1 to MAX_SHOPPING_LIST_SIZE
+#endif
+
+/** Units a clerk moves from the central inventory into its own stock shard at once */
+#ifndef STOCK_REFILL_BATCH
+#define STOCK_REFILL_BATCH 8 // Any positive integer, 1 takes every unit from the central inventory
+#endif
+
+/** Restocking modes of the supplier */
+#define RESTOCK_NONE      0 // No supplier, stock only goes down
+#define RESTOCK_SCHEDULED 1 // Each round, top up the next RESTOCK_ROUND_SIZE products round robin
+#define RESTOCK_THRESHOLD 2 // Each round, top up the products that fell below RESTOCK_THRESHOLD_PCT
+
+/** How the supplier restocks the central inventory */
+#ifndef RESTOCK_MODE
+#define RESTOCK_MODE RESTOCK_NONE // One of the RESTOCK_* modes above
+#endif
+
+/** Time between two supplier rounds in microseconds */
+#ifndef SUPPLIER_INTERVAL_US
+#define SUPPLIER_INTERVAL_US 1000 // Any positive integer
+#endif
+
+/** Products topped up per round (RESTOCK_SCHEDULED only) */
+#ifndef RESTOCK_ROUND_SIZE
+#define RESTOCK_ROUND_SIZE 16 // Any positive integer
+#endif
+
+/** Central stock level, in percent of the initial stock, below which a product is restocked (RESTOCK_THRESHOLD only) */
+#ifndef RESTOCK_THRESHOLD_PCT
+#define RESTOCK_THRESHOLD_PCT 25 // 0 to 100
+#endif
+
+/** Thread placement policies */
+#define PLACEMENT_NONE    0 // Leave thread placement to the operating system
+#define PLACEMENT_COMPACT 1 // Pin clerks to neighbouring CPUs, filling one NUMA node first
+#define PLACEMENT_SCATTER 2 // Pin clerks round robin across NUMA nodes
+
+/** How clerk, assistant and customer threads are placed on CPUs */
+#ifndef PLACEMENT_POLICY
+#define PLACEMENT_POLICY PLACEMENT_NONE // One of the PLACEMENT_* policies above
 #endif
 
 /** Scales the work needed to prepare a product */
@@ -33,6 +234,36 @@
 #define ASSISTANT_WORK_INTENSITY 10 // Any positive integer, tested up to 10000
 #endif
 
+/** Assistant preparation modes */
+#define ASSISTANT_PREP_FULL     0 // Every job pays the full preparation cost, simulating real work
+#define ASSISTANT_PREP_COALESCE 1 // Queued jobs for the same product share one preparation
+#define ASSISTANT_PREP_MEMOIZE  2 // Like COALESCE, and results are cached by (product, intensity)
+
+/** How the assistant prepares products */
+#ifndef ASSISTANT_PREP_MODE
+#define ASSISTANT_PREP_MODE ASSISTANT_PREP_MEMOIZE // One of the ASSISTANT_PREP_* modes above
+#endif
+
+/** Assistant scheduling policies */
+#define ASSISTANT_SCHED_FIFO 0 // Jobs are prepared in the order they were submitted
+#define ASSISTANT_SCHED_SJF  1 // Shortest job first, by the product's preparation cost
+#define ASSISTANT_SCHED_EDF  2 // Earliest deadline first, the clerk waiting longest goes first
+
+/** Order in which the assistant prepares queued jobs */
+#ifndef ASSISTANT_SCHEDULER
+#define ASSISTANT_SCHEDULER ASSISTANT_SCHED_FIFO // One of the ASSISTANT_SCHED_* policies above
+#endif
+
+/** Maximum number of queued jobs the assistant takes and coalesces at once, 1 with ASSISTANT_PREP_FULL */
+#ifndef ASSISTANT_BATCH_SIZE
+#define ASSISTANT_BATCH_SIZE 32 // Any positive integer
+#endif
+
+/** Pause iterations a thread may spin in a handshake before parking in the kernel */
+#ifndef SPIN_PARK_MAX_SPINS
+#define SPIN_PARK_MAX_SPINS 4096 // Any non-negative integer, 0 parks immediately like a condition variable
+#endif
+
 /** Controls debug output (1 = enabled, 0 = disabled) */
 #ifndef ENABLE_PRINTING
 #define ENABLE_PRINTING 1 // Set to 0 to disable all print statements
@@ -43,6 +274,31 @@
 #define ENABLE_ASSERTS 1 // Set to 0 to disable all assert statements
 #endif
 
+/** Controls the statistics report printed after each simulation (1 = enabled, 0 = disabled) */
+#ifndef ENABLE_STATS
+#define ENABLE_STATS 1 // Set to 0 to disable latency and throughput reports
+#endif
+
+/** Controls hardware performance counters per phase and thread role (1 = enabled, 0 = disabled) */
+#ifndef ENABLE_PERF_COUNTERS
+#define ENABLE_PERF_COUNTERS 0 // Set to 1 to report cycles, instructions, cache misses and context switches
+#endif
+
+/** Controls the lock contention profiler (1 = enabled, 0 = disabled) */
+#ifndef ENABLE_LOCK_PROFILING
+#define ENABLE_LOCK_PROFILING 0 // Set to 1 to report waits and hold times of every mutex
+#endif
+
+/** Controls the live metrics exporter (1 = enabled, 0 = disabled) */
+#ifndef ENABLE_METRICS
+#define ENABLE_METRICS 0 // Set to 1 to count events and serve snapshots on METRICS_SOCKET_PATH
+#endif
+
+/** Unix domain socket the metrics exporter listens on */
+#ifndef METRICS_SOCKET_PATH
+#define METRICS_SOCKET_PATH "/tmp/ekspedientki.sock"
+#endif
+
 /** Special value to signify the end of a queue */
 #define SENTINEL_VALUE ((void*)(-1))
 
@@ -0,0 +1,69 @@
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include "parameters.h"
+
+/**
+ * Performance Counter Module
+ *
+ * This module measures hardware and kernel events with perf_event_open:
+ * cycles, instructions, last-level cache misses and context switches.
+ * Every instrumented thread opens its own counters when it starts and
+ * folds them into the total of its role when it exits. At each phase
+ * boundary of a simulation the main thread reads the counters of all
+ * live threads, so a phase's counts cover every thread that ran in it.
+ *
+ * Events the kernel or the machine does not support (hardware counters in
+ * most virtual machines, or a restrictive perf_event_paranoid) are
+ * reported as n/a; the simulation runs the same either way. With
+ * ENABLE_PERF_COUNTERS set to 0 every function returns immediately.
+ */
+
+/**
+ * Roles of instrumented threads.
+ */
+typedef enum perf_role_t {
+    PERF_ROLE_MAIN,          // Thread running zso()
+    PERF_ROLE_SPAWNER,       // Customer spawner threads
+    PERF_ROLE_CUSTOMER,      // Customer threads
+    PERF_ROLE_CLERK,         // Clerk threads
+    PERF_ROLE_ASSISTANT,     // Assistant thread
+    PERF_ROLE_KIOSK,         // Self-checkout kiosk workers
+    PERF_NUM_ROLES
+} perf_role_t;
+
+/**
+ * Prepares the counters for a simulation and starts the first phase.
+ * Must be called by the main thread before any other thread starts.
+ *
+ * @param first_phase Name of the first phase
+ */
+void perf_init(const char* first_phase);
+
+/**
+ * Opens the calling thread's counters.
+ *
+ * @param role Role of the calling thread
+ */
+void perf_thread_begin(perf_role_t role);
+
+/**
+ * Adds the calling thread's counts to its role and closes its counters.
+ */
+void perf_thread_end();
+
+/**
+ * Ends the current phase and starts the next one.
+ *
+ * Ending the last phase also closes the main thread's counters.
+ *
+ * @param next_phase Name of the next phase, NULL to end the last phase
+ */
+void perf_phase(const char* next_phase);
+
+/**
+ * Prints the counts of every phase and every role.
+ */
+void perf_report();
+
+#endif /* PERFCOUNT_H */
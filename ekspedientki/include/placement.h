@@ -0,0 +1,54 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include "parameters.h"
+
+/**
+ * Placement Module
+ *
+ * This module decides on which CPUs the shop's threads run.
+ * The topology (usable CPUs and their NUMA nodes) is read from sysfs once per
+ * simulation and turned into a plan according to PLACEMENT_POLICY:
+ * each clerk is pinned to its own CPU, the assistant gets its own CPU, and
+ * customers run on the NUMA node of the clerk whose queue they join so the
+ * customer<->clerk handshake stays within one node.
+ * With PLACEMENT_NONE every function is a no-op.
+ */
+
+/**
+ * Reads the CPU topology and computes the placement plan.
+ * Must be called before any clerk, assistant or customer thread starts.
+ */
+void placement_init();
+
+/**
+ * Pins the calling thread to the CPU planned for the given clerk.
+ *
+ * @param clerk_id ID of the clerk
+ */
+void placement_pin_clerk(int clerk_id);
+
+/**
+ * Pins the calling thread to the CPU planned for the assistant.
+ */
+void placement_pin_assistant();
+
+/**
+ * Restricts the calling customer thread to the NUMA node of a clerk,
+ * avoiding the assistant's CPU where possible.
+ *
+ * @param clerk_id ID of the clerk whose queue the customer joined
+ */
+void placement_pin_customer(int clerk_id);
+
+/**
+ * Prints the placement policy and the planned CPU of every clerk.
+ */
+void placement_report();
+
+/**
+ * Frees the placement plan.
+ */
+void placement_destroy();
+
+#endif /* PLACEMENT_H */
@@ -0,0 +1,86 @@
+#ifndef PQUEUE_H
+#define PQUEUE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Priority Queue Module
+ *
+ * This module implements a thread-safe priority queue used to schedule the
+ * assistant's jobs. Items with the smallest priority value come out first;
+ * items with equal priority come out in the order they were pushed, so a
+ * queue where every item has the same priority behaves like a FIFO queue.
+ * Items are stored in a binary heap backed by one growing array, so pushing
+ * does not allocate per item.
+ */
+
+/**
+ * Represents an entry in the heap.
+ */
+typedef struct pqueue_entry {
+    long long priority;          // Smaller values are popped first
+    unsigned long long sequence; // Push order, breaks ties between equal priorities
+    void* data;                  // Pointer to stored data
+} pqueue_entry;
+
+/**
+ * Thread-safe priority queue structure with mutex and condition variable.
+ */
+typedef struct
+{
+    pqueue_entry* heap;          // Binary min-heap of entries
+    int size;                    // Number of items in queue
+    int capacity;                // Allocated entries in heap
+    unsigned long long next_sequence; // Sequence number of the next push
+
+    pthread_mutex_t lock;        // Mutex for thread safety
+    pthread_cond_t cond;         // Condition variable for signaling
+} pqueue;
+
+/**
+ * Create a new empty priority queue.
+ *
+ * @return Pointer to newly allocated priority queue structure
+ */
+pqueue* pqueue_create();
+
+/**
+ * Add an item with the given priority.
+ *
+ * @param q Pointer to priority queue structure
+ * @param data Pointer to data to enqueue
+ * @param priority Priority of the item, smaller values are popped first
+ */
+void pqueue_push(pqueue* q, void* data, long long priority);
+
+/**
+ * Remove up to max items in priority order in one locked section.
+ * Blocks if queue is empty until at least one item is available.
+ *
+ * @param q Pointer to priority queue structure
+ * @param out Array receiving the dequeued data, highest priority first
+ * @param max Maximum number of items to dequeue
+ * @return Number of items dequeued, 0 if queue is invalid
+ */
+int pqueue_pop_batch(pqueue* q, void** out, int max);
+
+/**
+ * Get the number of items in the priority queue.
+ *
+ * @param q Pointer to priority queue structure
+ * @return Number of items in the queue
+ */
+int pqueue_size(pqueue* q);
+
+/**
+ * Destroy priority queue and free all associated memory.
+ * Does not free data stored in the queue.
+ *
+ * @param q Pointer to priority queue structure to destroy
+ */
+void pqueue_destroy(pqueue* q);
+
+#endif /* PQUEUE_H */
@@ -0,0 +1,90 @@
+#ifndef PRICING_H
+#define PRICING_H
+
+#include <stdbool.h>
+
+/**
+ * Pricing Module
+ *
+ * This module prices a whole basket at once, applying the shop's
+ * promotions. Promotions are read from a rules file and compiled into
+ * per-product tables when the simulation starts:
+ *   - category discounts are folded into a promotional unit price,
+ *   - multi-buy offers become the "every Nth unit is free" count of a product,
+ *   - coupons are a small table indexed by coupon number.
+ * Pricing a basket then costs the same whatever the number of rules: the
+ * unit prices and multi-buy counts are gathered for the whole basket with
+ * SIMD where the CPU supports it (AVX2), the rank of each unit among equal
+ * products is computed with vector compares, and the customer's coupon is
+ * a single lookup.
+ *
+ * Rules file format, one rule per line, '#' starts a comment:
+ *   category,<category>,<percent off>
+ *   multibuy,<product id>,<n>         every n-th unit of the product is free
+ *   coupon,<min spend>,<cents off>    coupon numbers follow file order
+ * When several rules apply to the same product, the largest category
+ * discount and the smallest multi-buy count win; rules do not stack.
+ */
+
+/** Most coupons a rules file may define */
+#define MAX_COUPONS 64
+
+/** Customer holds no coupon */
+#define NO_COUPON -1
+
+/**
+ * Sets the promotions file compiled by pricing_init().
+ *
+ * @param path Path of the rules file, NULL for no promotions
+ */
+void set_promotions_file(const char* path);
+
+/**
+ * Compiles the promotions into per-product tables for the loaded catalog.
+ * Must be called after initialize_products().
+ * Exits the program if the rules file cannot be read or is malformed.
+ */
+void pricing_init();
+
+/**
+ * Gets the number of coupons defined by the promotions.
+ *
+ * @return Number of coupons, coupon numbers run from 0 to this minus one
+ */
+int pricing_num_coupons();
+
+/**
+ * Prices a basket with all promotions applied.
+ * Exits the program on an unknown product id.
+ *
+ * @param product_ids IDs of the products in the basket
+ * @param count Number of products in the basket
+ * @param coupon Coupon presented by the customer, NO_COUPON for none
+ * @return Total price of the basket in cents
+ */
+int pricing_price_basket(const int* product_ids, int count, int coupon);
+
+/**
+ * Prices a basket like pricing_price_basket(), always with the scalar code.
+ * Used to check and benchmark the vectorized path.
+ */
+int pricing_price_basket_scalar(const int* product_ids, int count, int coupon);
+
+/**
+ * Reports whether baskets are priced with the vectorized code.
+ *
+ * @return true if the CPU supports the vectorized path
+ */
+bool pricing_vectorized();
+
+/**
+ * Prints the number of promotion rules and which pricing code is used.
+ */
+void pricing_report();
+
+/**
+ * Frees the compiled promotion tables.
+ */
+void pricing_destroy();
+
+#endif /* PRICING_H */
@@ -1,8 +1,21 @@
 #ifndef PRODUCT_H
 #define PRODUCT_H
 
+#include "parameters.h"
+
 /* Parameters */
-#define MAX_PRODUCTS 50
+#define MAX_PRODUCTS 50 // Number of products in the built-in catalog
+#define MAX_CATEGORIES 256 // Categories are stored in one byte
+#define NUM_STOCK_SHARDS (NUM_CLERKS + NUM_KIOSKS) // One stock shard per clerk and per kiosk worker
+
+/* Categories of the built-in catalog */
+#define CATEGORY_PANTRY 0
+#define CATEGORY_PRODUCE 1
+#define CATEGORY_DAIRY 2
+#define CATEGORY_BAKERY 3
+#define CATEGORY_DRINKS 4
+#define CATEGORY_SNACKS 5
+#define CATEGORY_MEAT 6
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,32 +28,127 @@
  * 
  * This module handles the shop's inventory system, providing
  * functionality to track, access, and modify product information.
+ * Products come from a catalog file when one is set, otherwise from the
+ * built-in catalog. Product ids need not be contiguous; products are also
+ * numbered by slot, 0 to product_count() - 1, in catalog order.
+ *
+ * Stock is sharded: each clerk sells from its own shard, which no other
+ * thread touches while it has stock, and refills it from the central
+ * inventory STOCK_REFILL_BATCH units at a time. Once the central inventory
+ * of a product runs out, a clerk takes the spare units other shards still
+ * hold, so every unit can be sold and no unit is sold twice.
+ *
+ * The central inventory is lock-free. It counts the units taken out and the
+ * units the supplier restocked; clerks take a batch with a CAS on the taken
+ * count, and the supplier only ever adds to the restocked count, so
+ * restocking never blocks a clerk.
  */
 
 /**
- * Represents a product in the shop inventory.
+ * Represents a product in the shop inventory as one record. This is the
+ * form products are described in when a catalog is built; the catalog
+ * itself stores each field in its own column.
  */
 typedef struct {
     int id;                // Unique product identifier
     char name[50];         // Product name
     int price;             // Product price in cents
-    int stock;             // Current inventory quantity
+    int stock;             // Base inventory quantity, scaled by the customer count at startup
     bool needs_assistant;  // Whether product requires assistant help
+    int prep_cost;         // Relative assistant preparation cost, 0 if no help is needed
+    int category;          // Product category, 0 to MAX_CATEGORIES - 1
 } product_t;
 
 /**
- * Initializes the product inventory with default products.
+ * Sets the catalog file loaded by initialize_products().
+ * 
+ * @param path Path of a CSV or binary catalog, NULL for the built-in catalog
+ */
+void set_product_catalog(const char* path);
+
+/**
+ * Initializes the product inventory from the catalog.
  * Must be called before any other product functions.
  */
 void initialize_products();
 
+/**
+ * Gets the number of products in the catalog.
+ * 
+ * @return Number of products
+ */
+int product_count();
+
+/**
+ * Gets the id of the product in a catalog slot.
+ * 
+ * @param slot Slot of the product, 0 to product_count() - 1
+ * @return ID of the product
+ */
+int product_id_at(int slot);
+
+/**
+ * Gets the loaded catalog, for modules that build their own per-product
+ * tables from it.
+ * 
+ * @return The catalog loaded by initialize_products()
+ */
+const struct catalog_t* product_catalog();
+
+/**
+ * Finds a product by its exact name.
+ * 
+ * @param name Name of the product
+ * @return ID of the product, -1 if no product has that name
+ */
+int find_product_by_name(const char* name);
+
 /**
  * Attempts to retrieve a product from inventory (decrements stock).
  * 
+ * @param shard Stock shard of the calling clerk, 0 to NUM_STOCK_SHARDS - 1
  * @param product_id ID of the product to retrieve
  * @return true if product was successfully retrieved, false otherwise
  */
-bool try_get_product(int product_id);
+bool try_get_product(int shard, int product_id);
+
+/**
+ * Takes a whole basket from inventory at once. The products that are in
+ * stock stay in the basket, in their order, the others are dropped.
+ * 
+ * @param shard Stock shard of the caller, 0 to NUM_STOCK_SHARDS - 1
+ * @param product_ids IDs of the products in the basket, compacted in place
+ * @param count Number of products in the basket
+ * @return Number of products taken, the new size of the basket
+ */
+int reserve_basket(int shard, int* product_ids, int count);
+
+/**
+ * Counts the units in stock, in the central inventory and all shards.
+ * Walks every product, meant for occasional snapshots only.
+ * 
+ * @param units Set to the number of units in stock
+ * @param out_of_stock Set to the number of products with no units left
+ */
+void inventory_levels(long* units, int* out_of_stock);
+
+/**
+ * Tops up a product's central inventory back to its initial stock.
+ * Called by the supplier only.
+ * 
+ * @param slot Slot of the product
+ * @return Number of units added
+ */
+int restock_product(int slot);
+
+/**
+ * Tops up every product flagged as low on stock since the last call.
+ * Called by the supplier only.
+ * 
+ * @param products_restocked Incremented by the number of products topped up
+ * @return Number of units added
+ */
+long restock_low_products(long* products_restocked);
 
 /**
  * Gets the price of a product.
@@ -50,6 +158,30 @@ bool try_get_product(int product_id);
  */
 int get_product_price(int product_id);
 
+/**
+ * Prints the catalog source, size and load time, and how the stock
+ * shards were used.
+ */
+void product_report();
+
+/**
+ * Gets the total price of a basket of products in one call.
+ * 
+ * @param product_ids IDs of the products in the basket
+ * @param count Number of products in the basket
+ * @return Sum of the products' prices in cents
+ */
+int price_basket(const int* product_ids, int count);
+
+/**
+ * Counts the products in a basket that require assistant preparation.
+ * 
+ * @param product_ids IDs of the products in the basket
+ * @param count Number of products in the basket
+ * @return Number of products that need the assistant
+ */
+int count_assistant_items(const int* product_ids, int count);
+
 /**
  * Cleans up product module resources.
  * Should be called before program exit.
@@ -64,4 +196,13 @@ void destroy_products();
  */
 bool product_needs_assistant(int product_id);
 
+/**
+ * Gets the relative cost of preparing a product.
+ * The assistant's work for a product scales with this cost.
+ * 
+ * @param product_id ID of the product to check
+ * @return Preparation cost, 0 for products that need no assistant
+ */
+int product_prep_cost(int product_id);
+
 #endif /* PRODUCT_H */
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define QUEUE_H
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,10 +31,11 @@ typedef struct
 {
     queue_node* head;        // Pointer to first node
     queue_node* tail;        // Pointer to last node
-    int size;               // Number of items in queue
+    int size;               // Number of items in queue, written with the lock held
 
     pthread_mutex_t lock;    // Mutex for thread safety
     pthread_cond_t cond;     // Condition variable for signaling
+    int event_fd;            // eventfd written on every push, -1 until queue_event_fd() is called
 } queue;
 
 /**
@@ -45,6 +47,35 @@ typedef struct
  */
 void* queue_pop(queue* q);
 
+/**
+ * Remove and return the first item from the queue without blocking.
+ * 
+ * @param q Pointer to queue structure
+ * @return Pointer to the dequeued data, NULL if the queue is empty or invalid
+ */
+void* queue_try_pop(queue* q);
+
+/**
+ * Remove and return the first item from the queue, waiting at most the
+ * given time for one to arrive.
+ * 
+ * @param q Pointer to queue structure
+ * @param timeout_ns Longest wait in nanoseconds, measured on CLOCK_MONOTONIC
+ * @return Pointer to the dequeued data, NULL on timeout or if queue is invalid
+ */
+void* queue_pop_timeout(queue* q, long long timeout_ns);
+
+/**
+ * Remove up to max items from the front of the queue in one locked section.
+ * Blocks if queue is empty until at least one item is available.
+ * 
+ * @param q Pointer to queue structure
+ * @param out Array receiving the dequeued data, in queue order
+ * @param max Maximum number of items to dequeue
+ * @return Number of items dequeued, 0 if queue is invalid
+ */
+int queue_pop_batch(queue* q, void** out, int max);
+
 /**
  * Add an item to the end of the queue.
  * 
@@ -53,6 +84,50 @@ void* queue_pop(queue* q);
  */
 void queue_push(queue* q, void* data);
 
+/**
+ * Remove a given item from anywhere in the queue.
+ * 
+ * @param q Pointer to queue structure
+ * @param data Pointer to the data to remove
+ * @return true if the item was found and removed, false if it is not in the queue
+ */
+bool queue_remove(queue* q, void* data);
+
+/**
+ * Get a file descriptor that becomes readable whenever items are pushed,
+ * so a consumer can wait on several queues at once with poll or epoll.
+ * The eventfd is created on the first call, already readable if the queue
+ * holds items, and closed by queue_destroy().
+ * 
+ * Consumers call queue_event_clear() after waking up and before taking
+ * items with queue_try_pop(), so no push is missed.
+ * 
+ * @param q Pointer to queue structure
+ * @return Non-blocking eventfd of the queue
+ */
+int queue_event_fd(queue* q);
+
+/**
+ * Reset the eventfd of the queue so it is not readable until the next push.
+ * 
+ * @param q Pointer to queue structure whose queue_event_fd() was called
+ */
+void queue_event_clear(queue* q);
+
+/**
+ * Remove and return the first item of whichever queue has one, waiting
+ * on the eventfds of all the queues at once. Earlier queues in the array
+ * are tried first. Each queue must have a single consumer, another one
+ * could clear its eventfd while an item is left for this caller.
+ * 
+ * @param queues Queues to wait on, 1 to 64 of them
+ * @param count Number of queues
+ * @param data Set to the dequeued data
+ * @param timeout_ns Longest wait in nanoseconds, negative to wait forever
+ * @return Index of the queue the item came from, -1 on timeout
+ */
+int queue_select(queue** queues, int count, void** data, long long timeout_ns);
+
 /**
  * Create a new empty queue.
  * 
@@ -76,4 +151,14 @@ void queue_destroy(queue* q);
  */
 int queue_size(queue* q);
 
+/**
+ * Get the number of items in the queue without taking its lock. The value
+ * may be stale by the time the caller uses it, so it is only meant for
+ * heuristics like picking the shortest queue.
+ * 
+ * @param q Pointer to queue structure
+ * @return Number of items in the queue at some recent point
+ */
+int queue_size_approx(queue* q);
+
 #endif
\ No newline at end of file
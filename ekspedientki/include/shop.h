@@ -8,6 +8,8 @@
 #include <unistd.h>
 
 #include "customer.h" // Include customer header for customer_t definition
+#include "stats.h"
+#include "metrics.h"
 
 /**
  * Shop Module
@@ -35,12 +37,31 @@ extern customer_record_t* customer_records;
  */
 int zso();
 
-/* Global variables for customer spawning */
-extern pthread_mutex_t spawner_mutex;
-extern pthread_cond_t spawner_cond;
+/* Global variables for customer spawning, updated atomically */
 extern int active_customers;     // Currently active customer threads
 extern int customers_spawned;    // Total customers created so far
 
+/* Latency of each customer from (scheduled) arrival until leaving the shop */
+extern latency_recorder_t customer_latency;
+
+/* Latency of served customers by basket size, index 0 for one item */
+extern latency_recorder_t basket_latency[MAX_SHOPPING_LIST_SIZE];
+
+/* Latency of each item after the first, from the customer's request until the clerk's answer */
+extern latency_recorder_t item_latency;
+
+/* Latency of each first item, which includes the wait in the queue */
+extern latency_recorder_t first_item_latency;
+
+/* Time each clerk spends waiting for a customer's assistant jobs */
+extern latency_recorder_t job_wait_latency;
+
+/* Live metrics updated by the clerks */
+extern metrics_counter_t customers_served_metric;
+extern metrics_counter_t items_scanned_metric;
+extern metrics_counter_t stockouts_metric;
+extern metrics_counter_t sales_cents_metric;
+
 /* Global variables for shop earnings */
 extern pthread_mutex_t safe_mutex;
 extern int shop_earnings;        // Total earnings collected from all clerks
@@ -50,6 +71,13 @@ extern int shop_earnings;        // Total earnings collected from all clerks
  */
 void signal_customer_exit();
 
+/**
+ * Counts how a customer's visit ended.
+ * 
+ * @param outcome Outcome of the visit
+ */
+void record_customer_outcome(customer_outcome_t outcome);
+
 /**
  * Collects money from a clerk into the shop's safe.
  * 
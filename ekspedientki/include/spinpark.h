@@ -0,0 +1,89 @@
+#ifndef SPINPARK_H
+#define SPINPARK_H
+
+#include <stdbool.h>
+
+#include "parameters.h"
+
+/**
+ * Spin-Park Module
+ *
+ * This module provides a hybrid wait primitive for short handshakes between
+ * two threads. A waiter first spins with `pause` and exponential backoff,
+ * hoping the other side answers within microseconds, and only then parks in
+ * the kernel on a futex. Each waiter keeps a spin budget that adapts to how
+ * fast the other side answered recently: answers that arrive while spinning
+ * grow the budget, waits that end up parked shrink it.
+ *
+ * The condition waited for is given as a predicate. It must only read state
+ * that the notifying side publishes before calling spin_park_notify().
+ */
+
+/**
+ * A wait point shared by the threads of one handshake.
+ */
+typedef struct spin_park_t {
+    int generation;          // Futex word, bumped by every notification
+    int parked;              // Number of threads parked in the kernel
+} spin_park_t;
+
+/**
+ * Adaptive spin budget of one waiting thread.
+ */
+typedef struct spin_budget_t {
+    int limit;               // Pause iterations to spin before parking
+} spin_budget_t;
+
+/**
+ * Predicate checked by a waiter, returns true when the wait is over.
+ */
+typedef bool (*spin_park_ready_fn)(void* arg);
+
+/**
+ * Initializes a wait point.
+ *
+ * @param p Pointer to the wait point
+ */
+void spin_park_init(spin_park_t* p);
+
+/**
+ * Initializes a spin budget. On a single CPU spinning cannot help, so the
+ * budget starts and stays at zero.
+ *
+ * @param budget Pointer to the spin budget
+ */
+void spin_budget_init(spin_budget_t* budget);
+
+/**
+ * Waits until ready(arg) returns true, spinning first and parking after
+ * the spin budget is used up. Adapts the budget to the observed wait.
+ *
+ * @param p Pointer to the wait point
+ * @param budget Spin budget of the calling thread
+ * @param ready Predicate that ends the wait
+ * @param arg Argument passed to the predicate
+ */
+void spin_park_wait(spin_park_t* p, spin_budget_t* budget, spin_park_ready_fn ready, void* arg);
+
+/**
+ * Waits like spin_park_wait(), giving up at a deadline.
+ *
+ * @param p Pointer to the wait point
+ * @param budget Spin budget of the calling thread
+ * @param ready Predicate that ends the wait
+ * @param arg Argument passed to the predicate
+ * @param deadline_ns Time on the now_ns() clock to give up at
+ * @return true if ready(arg) returned true, false if the deadline passed first
+ */
+bool spin_park_wait_until(spin_park_t* p, spin_budget_t* budget, spin_park_ready_fn ready, void* arg,
+                          long long deadline_ns);
+
+/**
+ * Wakes the threads waiting on a wait point so they re-check their predicate.
+ * Call after publishing the state the waiters are looking for.
+ *
+ * @param p Pointer to the wait point
+ */
+void spin_park_notify(spin_park_t* p);
+
+#endif /* SPINPARK_H */
@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+/**
+ * Statistics Module
+ *
+ * This module provides monotonic timestamps and latency recorders used to
+ * measure the simulation. Recorders collect raw samples so percentiles can be
+ * computed exactly at the end of a run; recording is lock-free so threads
+ * can record from hot paths.
+ */
+
+/**
+ * Collects latency samples (in nanoseconds) for one measured quantity.
+ */
+typedef struct latency_recorder_t {
+    const char* name;        // Name printed in the report
+    long long* samples;      // Recorded samples in nanoseconds
+    int capacity;            // Maximum number of samples kept
+    int count;               // Number of samples recorded (may exceed capacity)
+} latency_recorder_t;
+
+/**
+ * Returns the current value of the monotonic clock.
+ *
+ * @return Current time in nanoseconds
+ */
+long long now_ns(void);
+
+/**
+ * Initializes a latency recorder.
+ *
+ * @param r Pointer to the recorder to initialize
+ * @param name Name printed in the report, must outlive the recorder
+ * @param capacity Maximum number of samples to keep
+ */
+void latency_recorder_init(latency_recorder_t* r, const char* name, int capacity);
+
+/**
+ * Records one latency sample. Thread-safe.
+ * Samples beyond the capacity are counted but dropped.
+ *
+ * @param r Pointer to the recorder
+ * @param ns Latency in nanoseconds
+ */
+void latency_recorder_add(latency_recorder_t* r, long long ns);
+
+/**
+ * Returns the given percentile of the recorded samples.
+ * Must not be called while other threads are still recording.
+ *
+ * @param r Pointer to the recorder
+ * @param percentile Percentile in the range [0, 100]
+ * @return Latency in nanoseconds, 0 if no samples were recorded
+ */
+long long latency_recorder_percentile(latency_recorder_t* r, double percentile);
+
+/**
+ * Prints a one-line summary (count, mean, p50, p90, p99, max) of the recorder.
+ * Must not be called while other threads are still recording.
+ *
+ * @param r Pointer to the recorder
+ */
+void latency_recorder_report(latency_recorder_t* r);
+
+/**
+ * Discards all samples so the recorder can be reused for another run.
+ *
+ * @param r Pointer to the recorder
+ */
+void latency_recorder_reset(latency_recorder_t* r);
+
+/**
+ * Frees the memory held by a latency recorder.
+ *
+ * @param r Pointer to the recorder
+ */
+void latency_recorder_destroy(latency_recorder_t* r);
+
+#endif /* STATS_H */
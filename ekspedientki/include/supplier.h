@@ -0,0 +1,31 @@
+#ifndef SUPPLIER_H
+#define SUPPLIER_H
+
+#include "parameters.h"
+
+/**
+ * Supplier Module
+ *
+ * This module runs the supplier thread, which restocks the central
+ * inventory every SUPPLIER_INTERVAL_US according to RESTOCK_MODE. The
+ * supplier only adds to the inventory's restocked counts, so it never
+ * blocks a clerk selling or refilling its stock shard. With RESTOCK_NONE
+ * no thread is started.
+ */
+
+/**
+ * Starts the supplier thread. Must be called after initialize_products().
+ */
+void supplier_start();
+
+/**
+ * Stops the supplier thread and waits for it to exit.
+ */
+void supplier_stop();
+
+/**
+ * Prints the supplier's rounds, products and units restocked and busy time.
+ */
+void supplier_report();
+
+#endif /* SUPPLIER_H */
@@ -0,0 +1,206 @@
+#include "admission.h"
+#include "parameters.h"
+#include "customer.h" // Include for printf_mutex
+#include "stats.h"
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "lockprof.h"
+
+/** Most limit changes kept for the report */
+#define MAX_LIMIT_CHANGES 1024
+
+/** Most limit changes printed by the report, spread over the run */
+#define REPORTED_LIMIT_CHANGES 16
+
+/**
+ * A change of the admission limit.
+ */
+typedef struct limit_change_t {
+    long long at_ns;    // Time since admission_init()
+    int limit;          // Limit from then on
+} limit_change_t;
+
+/* Global Variables */
+static sem_t admission_slots;     // Free places in the shop
+static int current_limit;         // Customers allowed in the shop
+static int withheld_slots;        // Slots leaving customers give up instead of returning
+
+/* Adaptive controller, only touched by clerks reporting waits */
+static pthread_mutex_t controller_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long long window[ADMISSION_WINDOW];
+static int window_count;
+static long long start_ns;
+static limit_change_t changes[MAX_LIMIT_CHANGES];
+static int num_changes;
+static int min_limit_seen;
+static int max_limit_seen;
+static int increases;
+static int decreases;
+
+void admission_init(int limit) {
+    if (sem_init(&admission_slots, 0, (unsigned int)limit) != 0) {
+        fprintf(stderr, "Error: sem_init failed for admission slots\n");
+        exit(1);
+    }
+    current_limit = limit;
+    withheld_slots = 0;
+    window_count = 0;
+    start_ns = now_ns();
+    changes[0].at_ns = 0;
+    changes[0].limit = limit;
+    num_changes = 1;
+    min_limit_seen = limit;
+    max_limit_seen = limit;
+    increases = 0;
+    decreases = 0;
+}
+
+void admission_acquire() {
+    while (sem_wait(&admission_slots) != 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "Error: sem_wait failed for admission slots\n");
+            exit(1);
+        }
+        // Interrupted by a signal, wait again
+    }
+}
+
+void admission_release() {
+    // Keep the slot if the limit was lowered while the shop was full
+    int withheld = __atomic_load_n(&withheld_slots, __ATOMIC_RELAXED);
+    while (withheld > 0) {
+        if (__atomic_compare_exchange_n(&withheld_slots, &withheld, withheld - 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    sem_post(&admission_slots);
+}
+
+/**
+ * Adds slots for a higher limit, first cancelling slots still withheld.
+ */
+static void add_slots(int count) {
+    while (count > 0) {
+        int withheld = __atomic_load_n(&withheld_slots, __ATOMIC_RELAXED);
+        if (withheld > 0) {
+            if (__atomic_compare_exchange_n(&withheld_slots, &withheld, withheld - 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                count--;
+            }
+            continue;
+        }
+        sem_post(&admission_slots);
+        count--;
+    }
+}
+
+/**
+ * Removes slots for a lower limit: free slots are taken at once, the rest
+ * are withheld from the next customers to leave.
+ */
+static void remove_slots(int count) {
+    while (count > 0 && sem_trywait(&admission_slots) == 0) {
+        count--;
+    }
+    if (count > 0) {
+        __atomic_fetch_add(&withheld_slots, count, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Orders waits by increasing duration.
+ */
+static int compare_waits(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Moves the limit after a full window of waits.
+ * Must be called with controller_mutex held.
+ */
+static void adjust_limit() {
+    qsort(window, ADMISSION_WINDOW, sizeof(window[0]), compare_waits);
+    long long p99_ns = window[(ADMISSION_WINDOW * 99) / 100];
+    window_count = 0;
+
+    int limit = current_limit;
+    if (p99_ns > ADMISSION_TARGET_P99_US * 1000LL) {
+        int cut = limit * ADMISSION_DECREASE_PCT / 100;
+        limit -= cut > 0 ? cut : 1;
+        limit = limit < ADMISSION_MIN_LIMIT ? ADMISSION_MIN_LIMIT : limit;
+    } else {
+        limit = limit < ADMISSION_MAX_LIMIT ? limit + 1 : ADMISSION_MAX_LIMIT;
+    }
+    if (limit == current_limit) {
+        return;
+    }
+
+    if (limit > current_limit) {
+        add_slots(limit - current_limit);
+        increases++;
+    } else {
+        remove_slots(current_limit - limit);
+        decreases++;
+    }
+    __atomic_store_n(&current_limit, limit, __ATOMIC_RELAXED);
+    min_limit_seen = limit < min_limit_seen ? limit : min_limit_seen;
+    max_limit_seen = limit > max_limit_seen ? limit : max_limit_seen;
+    if (num_changes < MAX_LIMIT_CHANGES) {
+        changes[num_changes].at_ns = now_ns() - start_ns;
+        changes[num_changes].limit = limit;
+        num_changes++;
+    }
+
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Admission limit is now %d (queue wait p99 %.1fus)\n", limit, p99_ns / 1e3);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+}
+
+void admission_record_wait(long long wait_ns) {
+    if (ADMISSION_MODE != ADMISSION_ADAPTIVE || ARRIVAL_MODE != ARRIVAL_CLOSED_LOOP) {
+        return;
+    }
+    pthread_mutex_lock(&controller_mutex);
+    window[window_count++] = wait_ns;
+    if (window_count == ADMISSION_WINDOW) {
+        adjust_limit();
+    }
+    pthread_mutex_unlock(&controller_mutex);
+}
+
+int admission_limit() {
+    return __atomic_load_n(&current_limit, __ATOMIC_RELAXED);
+}
+
+void admission_report() {
+    if (ADMISSION_MODE != ADMISSION_ADAPTIVE || ARRIVAL_MODE != ARRIVAL_CLOSED_LOOP) {
+        return;
+    }
+    printf("[stats] admission: mode=adaptive target_p99=%dus start=%d final=%d min=%d max=%d "
+           "increases=%d decreases=%d\n",
+           ADMISSION_TARGET_P99_US, changes[0].limit, current_limit, min_limit_seen,
+           max_limit_seen, increases, decreases);
+
+    // The limit over time, at most REPORTED_LIMIT_CHANGES points spread over the run
+    printf("[stats] admission: limit");
+    int step = (num_changes + REPORTED_LIMIT_CHANGES - 1) / REPORTED_LIMIT_CHANGES;
+    for (int i = 0; i < num_changes; i += step) {
+        printf(" %.1fms=%d", changes[i].at_ns / 1e6, changes[i].limit);
+    }
+    if ((num_changes - 1) % step != 0) {
+        printf(" %.1fms=%d", changes[num_changes - 1].at_ns / 1e6, changes[num_changes - 1].limit);
+    }
+    printf("\n");
+}
+
+void admission_destroy() {
+    sem_destroy(&admission_slots);
+}
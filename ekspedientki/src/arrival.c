@@ -0,0 +1,100 @@
+#include "arrival.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Global Variables */
+static long long* arrival_offsets = NULL; // Scheduled arrival offsets in nanoseconds
+static int scheduled_customers = 0;       // Number of entries in arrival_offsets
+
+/**
+ * Returns a uniformly distributed value in (0, 1) from a xorshift generator.
+ *
+ * @param state Generator state, must not be zero
+ * @return Pseudo-random value strictly between 0 and 1
+ */
+static double next_uniform(unsigned long long* state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    // Use the top 53 bits and shift away from 0 so log() is always defined
+    return ((x >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/**
+ * Maps time spent in ON periods to wall-clock time by inserting OFF gaps.
+ *
+ * @param active_ns Time measured only across ON periods
+ * @return Corresponding wall-clock offset
+ */
+static long long insert_off_periods(double active_ns) {
+    const double on_ns = BURST_ON_US * 1000.0;
+    const double off_ns = BURST_OFF_US * 1000.0;
+    double completed_bursts = floor(active_ns / on_ns);
+    return (long long)(active_ns + completed_bursts * off_ns);
+}
+
+void arrival_schedule_init(int num_customers) {
+    arrival_offsets = malloc(sizeof(long long) * (num_customers > 0 ? num_customers : 1));
+    if (arrival_offsets == NULL) {
+        fprintf(stderr, "Error: malloc failed for arrival schedule\n");
+        exit(1);
+    }
+    scheduled_customers = num_customers;
+
+    unsigned long long state = ARRIVAL_SEED ? ARRIVAL_SEED : 1;
+    const double mean_gap_ns = 1e9 / ARRIVAL_RATE;
+
+    // Bursty arrivals use a higher rate during ON periods so that the
+    // average over a full ON/OFF cycle still matches ARRIVAL_RATE
+    const double burst_gap_ns = mean_gap_ns * BURST_ON_US / (double)(BURST_ON_US + BURST_OFF_US);
+
+    double t = 0;
+    for (int i = 0; i < num_customers; i++) {
+        switch (ARRIVAL_MODE) {
+            case ARRIVAL_CONSTANT:
+                t = i * mean_gap_ns;
+                arrival_offsets[i] = (long long)t;
+                break;
+            case ARRIVAL_POISSON:
+                t += -log(next_uniform(&state)) * mean_gap_ns;
+                arrival_offsets[i] = (long long)t;
+                break;
+            case ARRIVAL_BURSTY:
+                t += -log(next_uniform(&state)) * burst_gap_ns;
+                arrival_offsets[i] = insert_off_periods(t);
+                break;
+            default:
+                // Closed loop has no schedule, customers arrive when slots free up
+                arrival_offsets[i] = 0;
+                break;
+        }
+    }
+}
+
+long long arrival_offset_ns(int customer_id) {
+    if (customer_id < 0 || customer_id >= scheduled_customers) {
+        return 0;
+    }
+    return arrival_offsets[customer_id];
+}
+
+void arrival_schedule_destroy() {
+    free(arrival_offsets);
+    arrival_offsets = NULL;
+    scheduled_customers = 0;
+}
+
+const char* arrival_mode_name() {
+    #if ARRIVAL_MODE == ARRIVAL_CONSTANT
+    return "constant";
+    #elif ARRIVAL_MODE == ARRIVAL_POISSON
+    return "poisson";
+    #elif ARRIVAL_MODE == ARRIVAL_BURSTY
+    return "bursty";
+    #else
+    return "closed-loop";
+    #endif
+}
@@ -1,32 +1,62 @@
 #include "assistant.h"
 #include "customer.h" // Include for printf_mutex
+#include "placement.h"
+#include "perfcount.h"
+#include "product.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include "lockprof.h"
 
 /* Global Variables */
-queue* assistant_queue = NULL;    // Queue for assistant tasks
-queue** clerk_inboxes = NULL;     // Array of queues, one per clerk
+pqueue* assistant_queue = NULL;   // Queue for assistant tasks
+job_queue_t** clerk_inboxes = NULL; // Array of inboxes, one per clerk
 pthread_t assistant_thread_id;    // Assistant thread ID
 int assistant_running = 1;        // Flag to control assistant thread
 static int next_job_id = 0;       // Counter for job IDs
 
+IQUEUE_DEFINE(job_queue, assistant_job_t, queue_next)
+
+/** Number of entries in the preparation cache, must be a power of two */
+#define PREP_CACHE_SIZE 1024
+
 /**
- * Initialize clerk inboxes
+ * A memoized preparation result, keyed by (product, intensity).
+ * Only the assistant thread touches the cache, so it needs no locking.
+ */
+typedef struct prep_cache_entry_t {
+    int product_id;           // Product the result belongs to, -1 if empty
+    int intensity;            // Work intensity the result was computed with
+    double result;            // Memoized preparation result
+} prep_cache_entry_t;
+
+static prep_cache_entry_t prep_cache[PREP_CACHE_SIZE];
+
+/* Assistant statistics, written by the assistant thread only */
+static int jobs_completed = 0;            // Jobs handed back to clerks
+static int preparations_computed = 0;     // Times prepare_product actually ran
+static int batches_taken = 0;             // Batches popped from the assistant queue
+static long long busy_ns = 0;             // Time spent preparing and delivering jobs
+
+/**
+ * Initialize clerk inboxes, kiosk workers get the slots after the clerks.
+ * Only the array is allocated here, each clerk creates its own inbox when it
+ * starts so the queue lives on the clerk's NUMA node.
  */
 void initialize_clerk_inboxes() {
-    clerk_inboxes = (queue**)malloc(sizeof(queue*) * NUM_CLERKS);
+    clerk_inboxes = (job_queue_t**)malloc(sizeof(job_queue_t*) * (NUM_CLERKS + NUM_KIOSKS));
     if (clerk_inboxes == NULL) {
         fprintf(stderr, "Error: malloc failed for clerk inboxes\n");
         exit(1);
     }
     
-    for (int i = 0; i < NUM_CLERKS; i++) {
-        clerk_inboxes[i] = queue_create();
+    for (int i = 0; i < NUM_CLERKS + NUM_KIOSKS; i++) {
+        clerk_inboxes[i] = NULL;
     }
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
-    printf("Initialized %d clerk inboxes\n", NUM_CLERKS);
+    printf("Initialized %d clerk inbox slots\n", NUM_CLERKS + NUM_KIOSKS);
     pthread_mutex_unlock(&printf_mutex);
     #endif
 }
@@ -39,8 +69,10 @@ void cleanup_clerk_inboxes() {
         return;
     }
     
-    for (int i = 0; i < NUM_CLERKS; i++) {
-        queue_destroy(clerk_inboxes[i]);
+    for (int i = 0; i < NUM_CLERKS + NUM_KIOSKS; i++) {
+        if (clerk_inboxes[i] != NULL) {
+            job_queue_destroy(clerk_inboxes[i]);
+        }
     }
     
     free(clerk_inboxes);
@@ -59,7 +91,10 @@ assistant_job_t* create_assistant_job(int product_id, int clerk_id) {
     
     job->product_id = product_id;
     job->clerk_id = clerk_id;
+    job->slot = 0;
     job->job_id = __sync_fetch_and_add(&next_job_id, 1); // Atomic increment
+    job->cost = product_prep_cost(product_id);
+    job->deadline_ns = now_ns();
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -70,6 +105,20 @@ assistant_job_t* create_assistant_job(int product_id, int clerk_id) {
     return job;
 }
 
+/**
+ * Queues a job with the priority given by the scheduling policy.
+ * FIFO gives every job the same priority, so push order decides.
+ */
+void assistant_submit_job(assistant_job_t* job) {
+    long long priority = 0;
+    if (ASSISTANT_SCHEDULER == ASSISTANT_SCHED_SJF) {
+        priority = job->cost;
+    } else if (ASSISTANT_SCHEDULER == ASSISTANT_SCHED_EDF) {
+        priority = job->deadline_ns;
+    }
+    pqueue_push(assistant_queue, job, priority);
+}
+
 /**
  * Waits for all jobs created by this clerk to complete.
  * The pending_jobs parameter indicates how many jobs the clerk is waiting for.
@@ -88,7 +137,7 @@ void wait_for_clerk_jobs(int clerk_id, int pending_jobs) {
     // Wait for the specified number of jobs to be completed
     for (int i = 0; i < pending_jobs; i++) {
         // This is a blocking call that waits until a job is available in the clerk's inbox
-        assistant_job_t* job = (assistant_job_t*)queue_pop(clerk_inboxes[clerk_id]);
+        assistant_job_t* job = job_queue_pop(clerk_inboxes[clerk_id]);
         
         #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
@@ -117,68 +166,190 @@ void free_assistant_job(assistant_job_t* job) {
 
 /**
  * Simulates the work required to prepare a special product.
- * Uses CPU-intensive math operations to represent the preparation time.
+ * Uses CPU-intensive math operations to represent the preparation time,
+ * which scales with the product's preparation cost.
  * 
+ * @param product_id Product being prepared
+ * @param intensity Scales the amount of work
  * @return A dummy result value representing the completed preparation
  */
-static double prepare_product(void) {
+static double prepare_product(int product_id, int intensity) {
+    int cost = product_prep_cost(product_id);
+    
     // Simulate work with some math operations
     double result = 0;
-    for (int i = 0; i < ASSISTANT_WORK_INTENSITY * 100; i++) {
+    for (int i = 0; i < intensity * 100 * cost; i++) {
         result += sin(i) * cos(i);
-        if (i % ASSISTANT_WORK_INTENSITY == 0) {
+        if (i % intensity == 0) {
             result = fmod(result, 10.0);  // Keep the number manageable
         }
     }
+    preparations_computed++;
     return result;
 }
 
+/**
+ * Empties the preparation cache, so every simulation starts cold.
+ */
+static void reset_prep_cache(void) {
+    for (int i = 0; i < PREP_CACHE_SIZE; i++) {
+        prep_cache[i].product_id = -1;
+    }
+}
+
+/**
+ * Returns the preparation result for a product, computing it only if it
+ * is not in the cache. Uses open addressing with linear probing; when the
+ * cache is full the result is computed without being stored.
+ */
+static double prepare_product_memoized(int product_id, int intensity) {
+    unsigned int hash = (unsigned int)product_id * 2654435761u ^ (unsigned int)intensity;
+    for (int probe = 0; probe < PREP_CACHE_SIZE; probe++) {
+        prep_cache_entry_t* entry = &prep_cache[(hash + probe) & (PREP_CACHE_SIZE - 1)];
+        if (entry->product_id == -1) {
+            entry->product_id = product_id;
+            entry->intensity = intensity;
+            entry->result = prepare_product(product_id, intensity);
+            return entry->result;
+        }
+        if (entry->product_id == product_id && entry->intensity == intensity) {
+            return entry->result;
+        }
+    }
+    return prepare_product(product_id, intensity);
+}
+
+/**
+ * Hands a prepared job back to the clerk that submitted it. The clerk may
+ * free the job as soon as it is in the inbox.
+ */
+static void deliver_job(assistant_job_t* job, double result) {
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Assistant finished preparing product %d (job %d, calculated %f)\n", 
+           job->product_id, job->job_id, result);
+    pthread_mutex_unlock(&printf_mutex);
+    #else
+    (void)result;
+    #endif
+    
+    job_queue_push(clerk_inboxes[job->clerk_id], job);
+    jobs_completed++;
+}
+
+/**
+ * Prepares the jobs of a batch in order according to ASSISTANT_PREP_MODE
+ * and delivers each one as soon as its result is ready, so a clerk never
+ * waits for the other jobs of the batch. Coalescing modes compute each
+ * distinct product once per batch and deliver every job of the batch for
+ * that product together.
+ * 
+ * @param jobs Jobs to prepare, in the order they should be served
+ * @param count Number of jobs
+ */
+static void prepare_batch(assistant_job_t** jobs, int count) {
+    bool delivered[ASSISTANT_BATCH_SIZE] = { false };
+    for (int i = 0; i < count; i++) {
+        if (delivered[i]) {
+            continue;
+        }
+        int product_id = jobs[i]->product_id;
+        
+        double result;
+        if (ASSISTANT_PREP_MODE == ASSISTANT_PREP_MEMOIZE) {
+            result = prepare_product_memoized(product_id, ASSISTANT_WORK_INTENSITY);
+        } else {
+            result = prepare_product(product_id, ASSISTANT_WORK_INTENSITY);
+        }
+        deliver_job(jobs[i], result);
+        
+        if (ASSISTANT_PREP_MODE == ASSISTANT_PREP_FULL) {
+            continue;
+        }
+        
+        // Reuse the result for the later jobs of the batch for the same product
+        for (int j = i + 1; j < count; j++) {
+            if (!delivered[j] && jobs[j]->product_id == product_id) {
+                delivered[j] = true;
+                deliver_job(jobs[j], result);
+            }
+        }
+    }
+}
+
+/**
+ * Prints the assistant's throughput for the finished simulation.
+ */
+void assistant_report() {
+    double busy_s = busy_ns / 1e9;
+    printf("[stats] assistant: mode=%s scheduler=%s jobs=%d preparations=%d batches=%d busy=%.3fms throughput=%.1f jobs/s\n",
+           ASSISTANT_PREP_MODE == ASSISTANT_PREP_FULL ? "full" :
+           ASSISTANT_PREP_MODE == ASSISTANT_PREP_COALESCE ? "coalesce" : "memoize",
+           ASSISTANT_SCHEDULER == ASSISTANT_SCHED_SJF ? "sjf" :
+           ASSISTANT_SCHEDULER == ASSISTANT_SCHED_EDF ? "edf" : "fifo",
+           jobs_completed, preparations_computed, batches_taken, busy_ns / 1e6,
+           busy_s > 0 ? jobs_completed / busy_s : 0);
+}
+
 /**
  * Main function for the assistant thread.
  */
 void* assistant_thread(void* arg) {
     (void)arg; // Suppress unused parameter warning
     
+    placement_pin_assistant();
+    perf_thread_begin(PERF_ROLE_ASSISTANT);
+    
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
     printf("Assistant has entered the shop\n");
     pthread_mutex_unlock(&printf_mutex);
     #endif
 
-    while (assistant_running) {
-        // Get a job from the queue (blocking operation)
-        void* job_ptr = queue_pop(assistant_queue);
+    // Start every simulation with a cold cache and fresh statistics
+    reset_prep_cache();
+    jobs_completed = 0;
+    preparations_computed = 0;
+    batches_taken = 0;
+    busy_ns = 0;
+    
+    void* batch[ASSISTANT_BATCH_SIZE];
+    assistant_job_t* jobs[ASSISTANT_BATCH_SIZE];
+    bool stop = false;
+    
+    while (assistant_running && !stop) {
+        // Take every queued job, up to the batch size (blocking operation).
+        // Without coalescing there is nothing to gain from a batch, so take
+        // one job at a time and let the scheduler pick again after each one.
+        int batch_limit = ASSISTANT_PREP_MODE == ASSISTANT_PREP_FULL ? 1 : ASSISTANT_BATCH_SIZE;
+        int count = pqueue_pop_batch(assistant_queue, batch, batch_limit);
+        long long batch_start_ns = now_ns();
+        batches_taken++;
         
-        // Check if this is the sentinel value signaling to stop
-        if (job_ptr == SENTINEL_VALUE) {
-            break;
+        // Check for the sentinel value signaling to stop, finishing the
+        // jobs queued before it first
+        int job_count = 0;
+        for (int i = 0; i < count; i++) {
+            if (batch[i] == SENTINEL_VALUE) {
+                stop = true;
+            } else {
+                jobs[job_count++] = (assistant_job_t*)batch[i];
+            }
         }
         
-        assistant_job_t* job = (assistant_job_t*)job_ptr;
-        
         #if ENABLE_PRINTING
-        pthread_mutex_lock(&printf_mutex);
-        printf("Assistant is preparing product %d for clerk %d (job %d)\n", 
-               job->product_id, job->clerk_id, job->job_id);
-        pthread_mutex_unlock(&printf_mutex);
+        for (int i = 0; i < job_count; i++) {
+            pthread_mutex_lock(&printf_mutex);
+            printf("Assistant is preparing product %d for clerk %d (job %d)\n", 
+                   jobs[i]->product_id, jobs[i]->clerk_id, jobs[i]->job_id);
+            pthread_mutex_unlock(&printf_mutex);
+        }
         #endif
         
-        // Simulate the work of preparing the product
-        #if ENABLE_ASSERTS || ENABLE_PRINTING
-        double result = prepare_product();
-        #else
-        prepare_product();
-        #endif
-
-        #if ENABLE_PRINTING
-        pthread_mutex_lock(&printf_mutex);
-        printf("Assistant finished preparing product %d (job %d, calculated %f)\n", 
-               job->product_id, job->job_id, result);
-        pthread_mutex_unlock(&printf_mutex);
-        #endif
+        // Simulate the work of preparing the products, handing each one back when ready
+        prepare_batch(jobs, job_count);
         
-        // Add the completed job to the clerk's inbox
-        queue_push(clerk_inboxes[job->clerk_id], job);
+        busy_ns += now_ns() - batch_start_ns;
     }
     
     #if ENABLE_PRINTING
@@ -187,5 +358,6 @@ void* assistant_thread(void* arg) {
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
+    perf_thread_end();
     return NULL;
 }
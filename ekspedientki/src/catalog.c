@@ -0,0 +1,475 @@
+#include "catalog.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Alignment of each array in the catalog block */
+#define CATALOG_ALIGN 8
+
+/**
+ * Rounds a block offset up to CATALOG_ALIGN.
+ */
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + CATALOG_ALIGN - 1) & ~(uint64_t)(CATALOG_ALIGN - 1);
+}
+
+/**
+ * FNV-1a hash of a product name.
+ */
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Checks that an array of count elements starting at offset lies inside the block.
+ */
+static bool array_fits(uint64_t offset, uint64_t count, size_t element_size, size_t block_size) {
+    return offset <= block_size && count <= (block_size - offset) / element_size;
+}
+
+/**
+ * Checks the contents of a catalog's indexes and name pool, so lookups on
+ * a loaded file stay inside the block and terminate: every bucket holds -1
+ * or a valid slot, every product is found by its id exactly where the id
+ * index says, and every name starts inside the pool, which ends with a NUL.
+ */
+static bool check_indexes(const catalog_t* catalog, uint32_t names_size) {
+    int id_buckets = 0;
+    for (int bucket = 0; bucket < catalog->id_index_size; bucket++) {
+        int32_t key = catalog->id_keys[bucket];
+        int32_t slot = catalog->id_slots[bucket];
+        if (key == -1) {
+            continue;
+        }
+        if (key < 0 || slot < 0 || slot >= catalog->count || catalog->ids[slot] != key) {
+            return false;
+        }
+        id_buckets++;
+    }
+    // With count filled buckets out of more than count, probing always ends
+    if (id_buckets != catalog->count) {
+        return false;
+    }
+    for (int slot = 0; slot < catalog->count; slot++) {
+        if (catalog_slot(catalog, catalog->ids[slot]) != slot || catalog->name_offsets[slot] >= names_size) {
+            return false;
+        }
+    }
+
+    int name_buckets = 0;
+    for (int bucket = 0; bucket < catalog->name_index_size; bucket++) {
+        int32_t slot = catalog->name_index[bucket];
+        if (slot < -1 || slot >= catalog->count) {
+            return false;
+        }
+        name_buckets += slot != -1;
+    }
+    if (name_buckets != catalog->count) {
+        return false;
+    }
+    return catalog->count == 0 || catalog->names[names_size - 1] == '\0';
+}
+
+/**
+ * Points the catalog's columns and indexes into its block, checking that
+ * the header describes arrays that fit in the block and that the indexes
+ * are consistent with the columns.
+ *
+ * @return true if the block is consistent
+ */
+static bool attach_block(catalog_t* catalog, void* block, size_t block_size) {
+    const catalog_header_t* h = (const catalog_header_t*)block;
+    if (block_size < sizeof(catalog_header_t) ||
+        memcmp(h->magic, CATALOG_MAGIC, sizeof(h->magic)) != 0 ||
+        h->total_size != block_size ||
+        h->count < 0 ||
+        h->id_index_size <= h->count ||
+        (h->id_index_size & (h->id_index_size - 1)) != 0 ||
+        h->name_index_size <= h->count ||
+        (h->name_index_size & (h->name_index_size - 1)) != 0) {
+        return false;
+    }
+
+    if (!array_fits(h->ids_offset, h->count, sizeof(int32_t), block_size) ||
+        !array_fits(h->prices_offset, h->count, sizeof(int32_t), block_size) ||
+        !array_fits(h->stock_offset, h->count, sizeof(int32_t), block_size) ||
+        !array_fits(h->prep_costs_offset, h->count, sizeof(int32_t), block_size) ||
+        !array_fits(h->flags_offset, h->count, sizeof(uint8_t), block_size) ||
+        !array_fits(h->categories_offset, h->count, sizeof(uint8_t), block_size) ||
+        !array_fits(h->name_offsets_offset, h->count, sizeof(uint32_t), block_size) ||
+        !array_fits(h->names_offset, h->names_size, sizeof(char), block_size) ||
+        !array_fits(h->id_keys_offset, h->id_index_size, sizeof(int32_t), block_size) ||
+        !array_fits(h->id_slots_offset, h->id_index_size, sizeof(int32_t), block_size) ||
+        !array_fits(h->name_index_offset, h->name_index_size, sizeof(int32_t), block_size)) {
+        return false;
+    }
+
+    char* base = (char*)block;
+    catalog->count = h->count;
+    catalog->ids = (const int32_t*)(base + h->ids_offset);
+    catalog->prices = (const int32_t*)(base + h->prices_offset);
+    catalog->stock = (const int32_t*)(base + h->stock_offset);
+    catalog->prep_costs = (const int32_t*)(base + h->prep_costs_offset);
+    catalog->flags = (const uint8_t*)(base + h->flags_offset);
+    catalog->categories = (const uint8_t*)(base + h->categories_offset);
+    catalog->name_offsets = (const uint32_t*)(base + h->name_offsets_offset);
+    catalog->names = base + h->names_offset;
+    catalog->id_keys = (const int32_t*)(base + h->id_keys_offset);
+    catalog->id_slots = (const int32_t*)(base + h->id_slots_offset);
+    catalog->id_index_size = h->id_index_size;
+    catalog->name_index = (const int32_t*)(base + h->name_index_offset);
+    catalog->name_index_size = h->name_index_size;
+    catalog->block = block;
+    catalog->block_size = block_size;
+    return check_indexes(catalog, h->names_size);
+}
+
+/**
+ * Reserves an aligned array in a block being laid out.
+ *
+ * @param end Current end of the block, advanced past the array
+ * @return Offset of the array
+ */
+static uint64_t reserve(uint64_t* end, uint64_t bytes) {
+    uint64_t offset = align_offset(*end);
+    *end = offset + bytes;
+    return offset;
+}
+
+void catalog_build(catalog_t* catalog, const product_t* products, int count) {
+    uint64_t names_size = 0;
+    for (int i = 0; i < count; i++) {
+        if (products[i].id < 0) {
+            fprintf(stderr, "Error: product '%s' has negative id %d\n", products[i].name, products[i].id);
+            exit(1);
+        }
+        if (products[i].price < 0 || products[i].stock < 0 || products[i].prep_cost < 0) {
+            fprintf(stderr, "Error: product %d has a negative price, stock or prep cost\n", products[i].id);
+            exit(1);
+        }
+        if (products[i].category < 0 || products[i].category >= MAX_CATEGORIES) {
+            fprintf(stderr, "Error: product %d has category %d, the limit is %d\n",
+                    products[i].id, products[i].category, MAX_CATEGORIES - 1);
+            exit(1);
+        }
+        names_size += strlen(products[i].name) + 1;
+    }
+    if (names_size > UINT32_MAX) {
+        fprintf(stderr, "Error: product names do not fit in the catalog\n");
+        exit(1);
+    }
+
+    // Keep both indexes at most half full so probe sequences stay short
+    int index_size = 2;
+    while (index_size < 2 * count) {
+        index_size *= 2;
+    }
+
+    catalog_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+    header.count = count;
+    header.id_index_size = index_size;
+    header.name_index_size = index_size;
+    header.names_size = (uint32_t)names_size;
+
+    uint64_t end = sizeof(catalog_header_t);
+    header.ids_offset = reserve(&end, (uint64_t)count * sizeof(int32_t));
+    header.prices_offset = reserve(&end, (uint64_t)count * sizeof(int32_t));
+    header.stock_offset = reserve(&end, (uint64_t)count * sizeof(int32_t));
+    header.prep_costs_offset = reserve(&end, (uint64_t)count * sizeof(int32_t));
+    header.flags_offset = reserve(&end, (uint64_t)count * sizeof(uint8_t));
+    header.categories_offset = reserve(&end, (uint64_t)count * sizeof(uint8_t));
+    header.name_offsets_offset = reserve(&end, (uint64_t)count * sizeof(uint32_t));
+    header.names_offset = reserve(&end, names_size);
+    header.id_keys_offset = reserve(&end, (uint64_t)index_size * sizeof(int32_t));
+    header.id_slots_offset = reserve(&end, (uint64_t)index_size * sizeof(int32_t));
+    header.name_index_offset = reserve(&end, (uint64_t)index_size * sizeof(int32_t));
+    header.total_size = end;
+
+    char* block = calloc(1, header.total_size);
+    if (block == NULL) {
+        fprintf(stderr, "Error: malloc failed for catalog\n");
+        exit(1);
+    }
+    memcpy(block, &header, sizeof(header));
+
+    int32_t* ids = (int32_t*)(block + header.ids_offset);
+    int32_t* prices = (int32_t*)(block + header.prices_offset);
+    int32_t* stock = (int32_t*)(block + header.stock_offset);
+    int32_t* prep_costs = (int32_t*)(block + header.prep_costs_offset);
+    uint8_t* flags = (uint8_t*)(block + header.flags_offset);
+    uint8_t* categories = (uint8_t*)(block + header.categories_offset);
+    uint32_t* name_offsets = (uint32_t*)(block + header.name_offsets_offset);
+    char* names = block + header.names_offset;
+    int32_t* id_keys = (int32_t*)(block + header.id_keys_offset);
+    int32_t* id_slots = (int32_t*)(block + header.id_slots_offset);
+    int32_t* name_index = (int32_t*)(block + header.name_index_offset);
+
+    for (int i = 0; i < index_size; i++) {
+        id_keys[i] = -1;
+        id_slots[i] = -1;
+        name_index[i] = -1;
+    }
+
+    uint32_t names_end = 0;
+    for (int slot = 0; slot < count; slot++) {
+        const product_t* p = &products[slot];
+        uint32_t id_bucket = catalog_hash_id(p->id) & (index_size - 1);
+        while (id_keys[id_bucket] != -1) {
+            if (id_keys[id_bucket] == p->id) {
+                fprintf(stderr, "Error: duplicate product id %d\n", p->id);
+                exit(1);
+            }
+            id_bucket = (id_bucket + 1) & (index_size - 1);
+        }
+        id_keys[id_bucket] = p->id;
+        id_slots[id_bucket] = slot;
+
+        ids[slot] = p->id;
+        prices[slot] = p->price;
+        stock[slot] = p->stock;
+        prep_costs[slot] = p->prep_cost;
+        flags[slot] = p->needs_assistant ? PRODUCT_FLAG_NEEDS_ASSISTANT : 0;
+        categories[slot] = (uint8_t)p->category;
+
+        size_t name_length = strlen(p->name) + 1;
+        name_offsets[slot] = names_end;
+        memcpy(names + names_end, p->name, name_length);
+        names_end += name_length;
+
+        // Linear probing, names need not be unique but the first one wins lookups
+        uint32_t bucket = hash_name(p->name) & (index_size - 1);
+        while (name_index[bucket] != -1) {
+            bucket = (bucket + 1) & (index_size - 1);
+        }
+        name_index[bucket] = slot;
+    }
+
+    if (!attach_block(catalog, block, header.total_size)) {
+        fprintf(stderr, "Error: catalog block failed its consistency check\n");
+        exit(1);
+    }
+    catalog->mapped = 0;
+}
+
+/**
+ * Copies the next comma-separated field of a CSV line.
+ *
+ * @return Pointer past the field's separator, NULL if the line has no more fields
+ */
+static char* next_field(char* cursor, char* field, size_t field_size) {
+    if (cursor == NULL) {
+        return NULL;
+    }
+    size_t length = strcspn(cursor, ",\r\n");
+    if (length >= field_size) {
+        length = field_size - 1;
+    }
+    memcpy(field, cursor, length);
+    field[length] = '\0';
+
+    cursor += strcspn(cursor, ",\r\n");
+    return *cursor == ',' ? cursor + 1 : NULL;
+}
+
+/**
+ * Parses a decimal integer field, exiting on malformed input.
+ */
+static int parse_int(const char* field, const char* path, int line) {
+    char* end;
+    errno = 0;
+    long value = strtol(field, &end, 10);
+    if (errno != 0 || end == field || *end != '\0' || value < -2147483647L || value > 2147483647L) {
+        fprintf(stderr, "Error: %s:%d: invalid number '%s'\n", path, line, field);
+        exit(1);
+    }
+    return (int)value;
+}
+
+/**
+ * Reads a CSV catalog into a heap-allocated product array.
+ *
+ * @param count Set to the number of products read
+ * @return Products in file order, owned by the caller
+ */
+static product_t* read_csv(const char* path, int* count) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: cannot open catalog %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    int capacity = 1024;
+    product_t* products = malloc(sizeof(product_t) * capacity);
+    if (products == NULL) {
+        fprintf(stderr, "Error: malloc failed for catalog\n");
+        exit(1);
+    }
+
+    char line[CATALOG_MAX_LINE];
+    char field[CATALOG_MAX_LINE];
+    int line_number = 0;
+    *count = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        if (line_number == 1 || line[0] == '\n' || line[0] == '\r') {
+            continue; // Header line or blank line
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            product_t* grown = realloc(products, sizeof(product_t) * capacity);
+            if (grown == NULL) {
+                fprintf(stderr, "Error: realloc failed for catalog\n");
+                exit(1);
+            }
+            products = grown;
+        }
+
+        product_t* p = &products[*count];
+        memset(p, 0, sizeof(*p));
+        char* cursor = line;
+
+        cursor = next_field(cursor, field, sizeof(field));
+        p->id = parse_int(field, path, line_number);
+
+        if (cursor == NULL || strcspn(cursor, ",\r\n") >= sizeof(p->name)) {
+            fprintf(stderr, "Error: %s:%d: missing or too long product name\n", path, line_number);
+            exit(1);
+        }
+        cursor = next_field(cursor, p->name, sizeof(p->name));
+
+        int values[4];
+        for (int i = 0; i < 4; i++) {
+            if (cursor == NULL) {
+                fprintf(stderr, "Error: %s:%d: expected 6 fields\n", path, line_number);
+                exit(1);
+            }
+            cursor = next_field(cursor, field, sizeof(field));
+            values[i] = parse_int(field, path, line_number);
+        }
+        p->price = values[0];
+        p->stock = values[1];
+        p->needs_assistant = values[2] != 0;
+        p->prep_cost = values[3];
+        if (p->price < 0 || p->stock < 0 || p->prep_cost < 0) {
+            fprintf(stderr, "Error: %s:%d: negative price, stock or prep cost\n", path, line_number);
+            exit(1);
+        }
+
+        // Optional category field
+        if (cursor != NULL) {
+            next_field(cursor, field, sizeof(field));
+            p->category = parse_int(field, path, line_number);
+        }
+        (*count)++;
+    }
+
+    fclose(file);
+    return products;
+}
+
+/**
+ * Maps a binary catalog file read-only.
+ *
+ * @return true if the file was mapped, false if it is not a valid binary catalog
+ */
+static bool map_binary(catalog_t* catalog, int fd, const char* path) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: cannot stat catalog %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    void* block = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (block == MAP_FAILED) {
+        fprintf(stderr, "Error: cannot map catalog %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    if (!attach_block(catalog, block, st.st_size)) {
+        munmap(block, st.st_size);
+        return false;
+    }
+    catalog->mapped = 1;
+    return true;
+}
+
+void catalog_load(catalog_t* catalog, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot open catalog %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    char magic[8] = { 0 };
+    ssize_t n = read(fd, magic, sizeof(magic));
+    if (n == (ssize_t)sizeof(magic) && memcmp(magic, CATALOG_MAGIC, sizeof(magic)) == 0) {
+        if (!map_binary(catalog, fd, path)) {
+            fprintf(stderr, "Error: %s is not a valid catalog for this build, recompile it\n", path);
+            exit(1);
+        }
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    int count;
+    product_t* products = read_csv(path, &count);
+    catalog_build(catalog, products, count);
+    free(products);
+}
+
+int catalog_compile(const char* csv_path, const char* binary_path) {
+    int count;
+    product_t* products = read_csv(csv_path, &count);
+    catalog_t catalog;
+    catalog_build(&catalog, products, count);
+    free(products);
+
+    FILE* file = fopen(binary_path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: cannot create %s: %s\n", binary_path, strerror(errno));
+        exit(1);
+    }
+    if (fwrite(catalog.block, 1, catalog.block_size, file) != catalog.block_size || fclose(file) != 0) {
+        fprintf(stderr, "Error: cannot write %s\n", binary_path);
+        exit(1);
+    }
+
+    catalog_destroy(&catalog);
+    return count;
+}
+
+int catalog_find_by_name(const catalog_t* catalog, const char* name) {
+    uint32_t mask = catalog->name_index_size - 1;
+    uint32_t bucket = hash_name(name) & mask;
+    while (catalog->name_index[bucket] != -1) {
+        int slot = catalog->name_index[bucket];
+        if (strcmp(catalog_name(catalog, slot), name) == 0) {
+            return slot;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return -1;
+}
+
+void catalog_destroy(catalog_t* catalog) {
+    if (catalog->block == NULL) {
+        return;
+    }
+    if (catalog->mapped) {
+        munmap(catalog->block, catalog->block_size);
+    } else {
+        free(catalog->block);
+    }
+    catalog->block = NULL;
+}
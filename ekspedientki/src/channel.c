@@ -0,0 +1,86 @@
+#include "channel.h"
+
+/**
+ * Initializes one direction of a channel.
+ */
+static void channel_init(channel_t* c) {
+    c->head = 0;
+    c->tail = 0;
+    spin_park_init(&c->wait);
+}
+
+void checkout_channel_init(checkout_channel_t* ch) {
+    channel_init(&ch->to_clerk);
+    channel_init(&ch->to_customer);
+}
+
+bool channel_try_send(channel_t* c, const checkout_msg_t* msg) {
+    unsigned int tail = c->tail; // Only the producer writes tail
+    unsigned int head = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+    if (tail - head == CHANNEL_CAPACITY) {
+        return false; // Full
+    }
+
+    c->slots[tail & (CHANNEL_CAPACITY - 1)] = *msg;
+    __atomic_store_n(&c->tail, tail + 1, __ATOMIC_RELEASE);
+
+    // Wake the consumer in case it is waiting for a message
+    spin_park_notify(&c->wait);
+    return true;
+}
+
+bool channel_try_recv(channel_t* c, checkout_msg_t* msg) {
+    unsigned int head = c->head; // Only the consumer writes head
+    unsigned int tail = __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE);
+    if (tail == head) {
+        return false; // Empty
+    }
+
+    *msg = c->slots[head & (CHANNEL_CAPACITY - 1)];
+    __atomic_store_n(&c->head, head + 1, __ATOMIC_RELEASE);
+
+    // A producer can only be waiting if the channel was full; tail cannot
+    // grow while it is, so this check cannot miss a waiting producer
+    if (tail - head == CHANNEL_CAPACITY) {
+        spin_park_notify(&c->wait);
+    }
+    return true;
+}
+
+/**
+ * Wait predicate: the channel has room for another message
+ */
+static bool has_space(void* arg) {
+    channel_t* c = (channel_t*)arg;
+    return __atomic_load_n(&c->tail, __ATOMIC_RELAXED) -
+           __atomic_load_n(&c->head, __ATOMIC_ACQUIRE) < CHANNEL_CAPACITY;
+}
+
+/**
+ * Wait predicate: the channel holds at least one message
+ */
+static bool has_message(void* arg) {
+    channel_t* c = (channel_t*)arg;
+    return __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) != __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+}
+
+void channel_send(channel_t* c, const checkout_msg_t* msg, spin_budget_t* budget) {
+    while (!channel_try_send(c, msg)) {
+        spin_park_wait(&c->wait, budget, has_space, c);
+    }
+}
+
+void channel_recv(channel_t* c, checkout_msg_t* msg, spin_budget_t* budget) {
+    while (!channel_try_recv(c, msg)) {
+        spin_park_wait(&c->wait, budget, has_message, c);
+    }
+}
+
+bool channel_recv_until(channel_t* c, checkout_msg_t* msg, spin_budget_t* budget, long long deadline_ns) {
+    while (!channel_try_recv(c, msg)) {
+        if (!spin_park_wait_until(&c->wait, budget, has_message, c, deadline_ns)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -1,14 +1,49 @@
 #include "clerk.h"
 #include "customer.h"
 #include "shop.h"  // Include for deposit_to_safe function
+#include "placement.h"
+#include "pricing.h"
+#include "admission.h"
+#include "clerkpool.h"
+#include "perfcount.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "lockprof.h"
 
 /* Global Variables */
-queue* clerk_queues[NUM_CLERKS];  // Array of queues, one per clerk
+customer_queue_t* clerk_queues[NUM_CLERKS]; // Array of queues, one per clerk
+
+/* Clerk statistics, added by each clerk as it leaves */
+static long long assistant_blocked_ns = 0; // Time clerks were blocked on their inbox
+static int customers_overlapped = 0;       // Customers taken while another waited for the assistant
+static int peak_inflight = 0;              // Most customers a clerk served at the same time
+static int scheduler_waits = 0;            // Times clerks serving several customers blocked
+
+/**
+ * Sources a clerk serving several customers waits on (CLERK_WAIT_EPOLL only).
+ */
+typedef struct clerk_events_t {
+    int epoll_fd;            // Watches the eventfds of both queues
+    customer_queue_t* customer_queue; // Source of new customers, wakes the clerk on close too
+    job_queue_t* inbox;      // Source of finished assistant jobs
+    bool watching_customers; // Whether the customer queue is watched now
+} clerk_events_t;
+
+/** Stack of each customer coroutine (CLERK_MAX_INFLIGHT > 1 only) */
+#define CLERK_COROUTINE_STACK_SIZE (64 * 1024)
 
 // Forward declarations of helper functions
+static void serve_one_at_a_time(clerk_t* self);
+static void serve_in_coroutines(clerk_t* self);
+static void serve_pipelined(clerk_t* self);
+static void accept_customer(clerk_t* clerk, customer_t* customer);
+static void serve_customer(clerk_slot_t* slot);
 static transaction_t* create_transaction(int shopping_list_size);
-static bool process_customer_item(clerk_t* clerk, customer_t* customer, transaction_t* transaction);
-static void finalize_transaction(clerk_t* clerk, customer_t* customer, transaction_t* transaction);
+static bool process_customer_item(clerk_slot_t* slot, transaction_t* transaction);
+static void wait_for_slot_jobs(clerk_slot_t* slot);
+static void finalize_transaction(clerk_t* clerk, spin_budget_t* spin_budget,
+                                 customer_t* customer, transaction_t* transaction);
 
 /**
  * Main function for the clerk thread.
@@ -16,8 +51,20 @@ static void finalize_transaction(clerk_t* clerk, customer_t* customer, transacti
 void* clerk_thread(void* arg) {
     clerk_t* self = (clerk_t*)arg;
     
-    // Initialize pending_jobs counter
-    self->pending_jobs = 0;
+    // Initialize customer slots and spin budget
+    for (int i = 0; i < CLERK_SLOTS; i++) {
+        self->slots[i].index = i;
+        self->slots[i].customer = NULL;
+        self->slots[i].pending_jobs = 0;
+        self->slots[i].clerk = self;
+    }
+    spin_budget_init(&self->spin_budget);
+    
+    // Move to the planned CPU, then create the inbox from here so its
+    // memory is first touched on this clerk's NUMA node
+    placement_pin_clerk(self->id);
+    perf_thread_begin(PERF_ROLE_CLERK);
+    clerk_inboxes[self->id] = job_queue_create();
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -25,70 +72,478 @@ void* clerk_thread(void* arg) {
     pthread_mutex_unlock(&printf_mutex);
     #endif
 
+    if (CLERK_PIPELINE_DEPTH > 1) {
+        serve_pipelined(self);
+    } else if (CLERK_MAX_INFLIGHT == 1) {
+        serve_one_at_a_time(self);
+    } else {
+        serve_in_coroutines(self);
+    }
+
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Clerk %d has made %d dollars and is leaving the shop\n", self->id, self->cash_register);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    // Deposit earnings to shop's safe
+    deposit_to_safe(self->cash_register);
+    
+    free(self);
+    perf_thread_end();
+    return NULL;
+}
+
+/**
+ * Serves the customers of the queue one after the other until the queue
+ * is closed and drained.
+ */
+static void serve_one_at_a_time(clerk_t* self) {
+    clerk_slot_t* slot = &self->slots[0];
     while (1) {
         // Wait for the next customer (blocking call)
-        void* customer_ptr = queue_pop(self->customer_queue);
+        customer_t* customer = customer_queue_pop(self->customer_queue);
         
-        // Check if this is the sentinel value signaling to stop
-        if (customer_ptr == SENTINEL_VALUE) {
+        // No customer means the queue is closed and drained
+        if (customer == NULL) {
             break;
         }
         
-        customer_t* customer = (customer_t*)customer_ptr;
+        clerk_pool_set_busy(self->id, true);
+        accept_customer(self, customer);
+        slot->customer = customer;
+        serve_customer(slot);
+        slot->customer = NULL;
+        clerk_pool_set_busy(self->id, false);
+    }
+}
+
+/**
+ * Adds the overlap statistics of a clerk that is leaving.
+ */
+static void add_overlap_stats(int peak, int overlapped) {
+    __sync_fetch_and_add(&customers_overlapped, overlapped);
+    int current = __atomic_load_n(&peak_inflight, __ATOMIC_RELAXED);
+    while (peak > current &&
+           !__atomic_compare_exchange_n(&peak_inflight, &current, peak, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Body of a customer coroutine.
+ */
+static void serve_customer_coroutine(void* arg) {
+    serve_customer((clerk_slot_t*)arg);
+}
+
+/**
+ * Resumes the coroutine of a slot, freeing the slot once its customer is served.
+ * 
+ * @return true if the customer is served
+ */
+static bool resume_slot(clerk_slot_t* slot) {
+    if (!coroutine_resume(&slot->coroutine)) {
+        return false;
+    }
+    slot->customer = NULL;
+    return true;
+}
+
+/**
+ * Hands a finished assistant job back to the slot that asked for it.
+ */
+static void deliver_job(clerk_t* self, assistant_job_t* job) {
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Clerk %d received completed job %d for product %d\n", self->id, job->job_id, job->product_id);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    self->slots[job->slot].pending_jobs--;
+    free_assistant_job(job);
+}
+
+/**
+ * Adds the eventfd of a queue to an epoll set.
+ */
+static void watch_queue(int epoll_fd, int event_fd, uint32_t events) {
+    struct epoll_event event = { .events = events, .data.fd = event_fd };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) != 0) {
+        fprintf(stderr, "Error: epoll_ctl failed for clerk queue\n");
+        exit(1);
+    }
+}
+
+/**
+ * Prepares the epoll set of a clerk's customer queue and inbox.
+ */
+static void clerk_events_init(clerk_events_t* events, clerk_t* clerk) {
+    events->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (events->epoll_fd < 0) {
+        fprintf(stderr, "Error: epoll_create1 failed for clerk %d\n", clerk->id);
+        exit(1);
+    }
+    events->customer_queue = clerk->customer_queue;
+    events->inbox = clerk_inboxes[clerk->id];
+    events->watching_customers = true;
+    watch_queue(events->epoll_fd, customer_queue_event_fd(events->customer_queue), EPOLLIN);
+    watch_queue(events->epoll_fd, job_queue_event_fd(events->inbox), EPOLLIN);
+}
+
+/**
+ * Waits until the customer queue, if watched, or the inbox has new items,
+ * then clears the eventfds that woke the clerk.
+ *
+ * @param watch_customers Whether a new customer could be taken now
+ */
+static void clerk_events_wait(clerk_events_t* events, bool watch_customers) {
+    // Stop watching the customer queue while every slot is taken,
+    // its eventfd would stay readable and wake the clerk for nothing
+    if (watch_customers != events->watching_customers) {
+        int event_fd = customer_queue_event_fd(events->customer_queue);
+        struct epoll_event event = { .events = watch_customers ? EPOLLIN : 0, .data.fd = event_fd };
+        if (epoll_ctl(events->epoll_fd, EPOLL_CTL_MOD, event_fd, &event) != 0) {
+            fprintf(stderr, "Error: epoll_ctl failed for clerk queue\n");
+            exit(1);
+        }
+        events->watching_customers = watch_customers;
+    }
+    
+    struct epoll_event ready[2];
+    int count;
+    while ((count = epoll_wait(events->epoll_fd, ready, 2, -1)) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "Error: epoll_wait failed for clerk\n");
+            exit(1);
+        }
+        // Interrupted by a signal, wait again
+    }
+    
+    // Clear before the caller takes items, so pushes from now on wake us again
+    for (int i = 0; i < count; i++) {
+        iqueue_event_clear(ready[i].data.fd);
+    }
+}
+
+/**
+ * Serves up to CLERK_MAX_INFLIGHT customers at the same time, each in its
+ * own coroutine, until its queue is closed and drained, then finishes the
+ * customers in flight. A coroutine only yields while its customer waits
+ * for the assistant. With CLERK_WAIT_CONDVAR the clerk then blocks on its
+ * queue when idle and on its inbox when every customer in flight is
+ * waiting, so a new customer waits for the next finished job. With
+ * CLERK_WAIT_EPOLL it wakes for whichever comes first.
+ */
+static void serve_in_coroutines(clerk_t* self) {
+    for (int i = 0; i < CLERK_MAX_INFLIGHT; i++) {
+        coroutine_init(&self->slots[i].coroutine, CLERK_COROUTINE_STACK_SIZE);
+    }
+    
+    clerk_events_t events;
+    if (CLERK_WAIT_MODE == CLERK_WAIT_EPOLL) {
+        clerk_events_init(&events, self);
+    }
+    
+    int busy = 0;
+    int peak = 0;
+    int overlapped = 0;
+    int waits = 0;
+    long long blocked_ns = 0;
+    bool stopping = false;
+    while (!stopping || busy > 0) {
+        // Hand back the jobs the assistant has finished so far
+        assistant_job_t* job;
+        while ((job = job_queue_try_pop(clerk_inboxes[self->id])) != NULL) {
+            deliver_job(self, job);
+        }
         
-        #if ENABLE_ASSERTS
-        assert(customer != NULL);
-        assert(customer->id >= 0);
-        assert(customer->wallet > 0);
-        assert(customer->shopping_list != NULL);
-        assert(customer->shopping_list_size > 0);
-        #endif
+        // Continue every customer whose jobs are all done
+        for (int i = 0; i < CLERK_MAX_INFLIGHT; i++) {
+            clerk_slot_t* slot = &self->slots[i];
+            if (slot->customer != NULL && slot->pending_jobs == 0 && resume_slot(slot)) {
+                busy--;
+            }
+        }
         
-        #if ENABLE_PRINTING
-        pthread_mutex_lock(&printf_mutex);
-        printf("Clerk %d is serving customer %d\n", self->id, customer->id);
-        pthread_mutex_unlock(&printf_mutex);
-        #endif
+        // Take another customer into a free slot, only blocking on the
+        // queue when idle and waiting on condition variables
+        customer_t* customer = NULL;
+        bool slot_free = !stopping && busy < CLERK_MAX_INFLIGHT;
+        if (slot_free) {
+            clerk_pool_set_busy(self->id, busy > 0);
+            if (busy == 0 && CLERK_WAIT_MODE == CLERK_WAIT_CONDVAR) {
+                waits++;
+                customer = customer_queue_pop(self->customer_queue);
+                stopping = customer == NULL;
+            } else {
+                customer = customer_queue_try_pop(self->customer_queue);
+                stopping = customer == NULL && customer_queue_drained(self->customer_queue);
+            }
+        }
+        
+        if (customer != NULL) {
+            clerk_slot_t* slot = &self->slots[0];
+            while (slot->customer != NULL) {
+                slot++;
+            }
+            clerk_pool_set_busy(self->id, true);
+            accept_customer(self, customer);
+            slot->customer = customer;
+            coroutine_start(&slot->coroutine, serve_customer_coroutine, slot);
+            overlapped += busy > 0;
+            busy++;
+            peak = busy > peak ? busy : peak;
+            if (resume_slot(slot)) {
+                busy--;
+            }
+        } else if (stopping && busy == 0) {
+            // The queue is closed and drained and every customer is served
+        } else if (CLERK_WAIT_MODE == CLERK_WAIT_EPOLL) {
+            // Wait for a new customer or a finished job, whichever comes first
+            long long blocked_start_ns = now_ns();
+            waits++;
+            clerk_events_wait(&events, slot_free && !stopping);
+            if (busy > 0) {
+                blocked_ns += now_ns() - blocked_start_ns;
+            }
+        } else if (busy > 0) {
+            // Every customer in flight waits for the assistant, so wait too
+            long long blocked_start_ns = now_ns();
+            waits++;
+            deliver_job(self, job_queue_pop(clerk_inboxes[self->id]));
+            blocked_ns += now_ns() - blocked_start_ns;
+        }
+    }
+    clerk_pool_set_busy(self->id, false);
+    if (CLERK_WAIT_MODE == CLERK_WAIT_EPOLL) {
+        close(events.epoll_fd);
+    }
+    
+    __sync_fetch_and_add(&assistant_blocked_ns, blocked_ns);
+    __sync_fetch_and_add(&scheduler_waits, waits);
+    add_overlap_stats(peak, overlapped);
+    
+    for (int i = 0; i < CLERK_MAX_INFLIGHT; i++) {
+        coroutine_destroy(&self->slots[i].coroutine);
+    }
+}
 
-        // Begin serving customer
-        pthread_mutex_lock(&customer->mutex);
+/**
+ * Waits until the assistant has returned every job of the customer at the
+ * head of the pipeline. Jobs of customers scanned later are counted in
+ * their own slots on the way.
+ */
+static void wait_for_pipelined_jobs(clerk_t* clerk, clerk_slot_t* slot) {
+    if (slot->delivered_jobs < slot->pending_jobs) {
+        long long wait_start_ns = now_ns();
+        while (slot->delivered_jobs < slot->pending_jobs) {
+            assistant_job_t* job = job_queue_pop(clerk_inboxes[clerk->id]);
+            clerk->slots[job->slot].delivered_jobs++;
+            free_assistant_job(job);
+        }
+        long long waited_ns = now_ns() - wait_start_ns;
+        __sync_fetch_and_add(&assistant_blocked_ns, waited_ns);
         
-        // Signal customer we're ready to serve them
-        customer->clerk_ready = true;
-        pthread_cond_signal(&customer->cond);
+        #if ENABLE_STATS
+        latency_recorder_add(&job_wait_latency, waited_ns);
+        #endif
+    }
+    slot->delivered_jobs = 0;
+}
+
+/**
+ * Main function for the cashier thread of a pipelined lane. Finishes the
+ * scanned customers in order until the clerk closes the lane.
+ */
+static void* cashier_thread(void* arg) {
+    clerk_t* clerk = (clerk_t*)arg;
+    perf_thread_begin(PERF_ROLE_CLERK);
+    
+    int next = 0;
+    while (1) {
+        pthread_mutex_lock(&clerk->pipeline_mutex);
+        while (clerk->scanned == next && !clerk->closing) {
+            pthread_cond_wait(&clerk->pipeline_cond, &clerk->pipeline_mutex);
+        }
+        bool done = clerk->scanned == next;
+        pthread_mutex_unlock(&clerk->pipeline_mutex);
+        if (done) {
+            break;
+        }
         
-        // Create a new transaction for this customer
-        transaction_t* transaction = create_transaction(customer->shopping_list_size);
+        clerk_slot_t* slot = &clerk->slots[next % CLERK_PIPELINE_DEPTH];
+        wait_for_pipelined_jobs(clerk, slot);
+        finalize_transaction(clerk, &clerk->cashier_spin_budget, slot->customer, slot->transaction);
         
-        // Process all items in the customer's shopping list
-        bool shopping_complete = false;
-        while (!shopping_complete) {
-            shopping_complete = process_customer_item(self, customer, transaction);
+        // Free the slot for the customer CLERK_PIPELINE_DEPTH places later
+        pthread_mutex_lock(&clerk->pipeline_mutex);
+        slot->customer = NULL;
+        clerk->paid = ++next;
+        if (clerk->paid == clerk->accepted) {
+            clerk_pool_set_busy(clerk->id, false);
         }
+        pthread_cond_broadcast(&clerk->pipeline_cond);
+        pthread_mutex_unlock(&clerk->pipeline_mutex);
+    }
+    
+    perf_thread_end();
+    return NULL;
+}
+
+/**
+ * Scans customers one after the other and hands them to the cashier,
+ * keeping at most CLERK_PIPELINE_DEPTH customers between scanning and
+ * payment, until its queue is closed and drained.
+ */
+static void serve_pipelined(clerk_t* self) {
+    pthread_mutex_init(&self->pipeline_mutex, NULL);
+    pthread_cond_init(&self->pipeline_cond, NULL);
+    self->accepted = 0;
+    self->scanned = 0;
+    self->paid = 0;
+    self->closing = false;
+    spin_budget_init(&self->cashier_spin_budget);
+    for (int i = 0; i < CLERK_PIPELINE_DEPTH; i++) {
+        self->slots[i].delivered_jobs = 0;
+    }
+    
+    int peak = 0;
+    int overlapped = 0;
+    pthread_t cashier;
+    int result = pthread_create(&cashier, NULL, cashier_thread, self);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to create cashier thread for clerk %d, error: %d\n", self->id, result);
+        exit(1);
+    }
+    
+    while (1) {
+        // Wait for a free slot before taking a customer off the queue, so
+        // the customers still waiting may leave it
+        pthread_mutex_lock(&self->pipeline_mutex);
+        while (self->accepted - self->paid == CLERK_PIPELINE_DEPTH) {
+            pthread_cond_wait(&self->pipeline_cond, &self->pipeline_mutex);
+        }
+        pthread_mutex_unlock(&self->pipeline_mutex);
         
-        // Wait for all assistant jobs to complete before finalizing the transaction
-        if (self->pending_jobs > 0) {
-            wait_for_clerk_jobs(self->id, self->pending_jobs);
-            self->pending_jobs = 0; // Reset counter after waiting
+        customer_t* customer = customer_queue_pop(self->customer_queue);
+        if (customer == NULL) {
+            break; // The queue is closed and drained
         }
         
-        // Complete the transaction and handle payment
-        finalize_transaction(self, customer, transaction);
+        pthread_mutex_lock(&self->pipeline_mutex);
+        clerk_slot_t* slot = &self->slots[self->accepted % CLERK_PIPELINE_DEPTH];
+        overlapped += self->accepted > self->paid;
+        self->accepted++;
+        peak = self->accepted - self->paid > peak ? self->accepted - self->paid : peak;
+        clerk_pool_set_busy(self->id, true);
+        pthread_mutex_unlock(&self->pipeline_mutex);
+        
+        accept_customer(self, customer);
+        slot->customer = customer;
+        slot->pending_jobs = 0;
+        slot->transaction = create_transaction(slot->customer->shopping_list_size);
         
-        pthread_mutex_unlock(&customer->mutex);
+        bool shopping_complete = false;
+        while (!shopping_complete) {
+            shopping_complete = process_customer_item(slot, slot->transaction);
+        }
+        
+        // Hand the basket to the cashier and start on the next customer
+        pthread_mutex_lock(&self->pipeline_mutex);
+        self->scanned++;
+        pthread_cond_broadcast(&self->pipeline_cond);
+        pthread_mutex_unlock(&self->pipeline_mutex);
+    }
+    
+    pthread_mutex_lock(&self->pipeline_mutex);
+    self->closing = true;
+    pthread_cond_broadcast(&self->pipeline_cond);
+    pthread_mutex_unlock(&self->pipeline_mutex);
+    
+    result = pthread_join(cashier, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to join cashier thread for clerk %d, error: %d\n", self->id, result);
+        exit(1);
     }
+    pthread_mutex_destroy(&self->pipeline_mutex);
+    pthread_cond_destroy(&self->pipeline_cond);
+    add_overlap_stats(peak, overlapped);
+}
 
+/**
+ * Records how long a customer waited in the queue before being served.
+ */
+static void accept_customer(clerk_t* clerk, customer_t* customer) {
+    long long queue_wait_ns = now_ns() - customer->queued_ns;
+    admission_record_wait(queue_wait_ns);
+    clerk_pool_record_wait(queue_wait_ns);
+    
+    #if ENABLE_ASSERTS
+    assert(customer != NULL);
+    assert(customer->id >= 0);
+    assert(customer->wallet > 0);
+    assert(customer->shopping_list != NULL);
+    assert(customer->shopping_list_size > 0);
+    #endif
+    
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
-    printf("Clerk %d has made %d dollars and is leaving the shop\n", self->id, self->cash_register);
+    printf("Clerk %d is serving customer %d\n", clerk->id, customer->id);
     pthread_mutex_unlock(&printf_mutex);
+    #else
+    (void)clerk;
     #endif
+}
+
+/**
+ * Serves the customer of a slot from the first item to the payment.
+ */
+static void serve_customer(clerk_slot_t* slot) {
+    // Create a new transaction for this customer
+    transaction_t* transaction = create_transaction(slot->customer->shopping_list_size);
     
-    // Deposit earnings to shop's safe
-    deposit_to_safe(self->cash_register);
+    // Process all items in the customer's shopping list
+    bool shopping_complete = false;
+    while (!shopping_complete) {
+        shopping_complete = process_customer_item(slot, transaction);
+    }
     
-    free(self);
-    return NULL;
+    // Wait for all assistant jobs to complete before finalizing the transaction
+    wait_for_slot_jobs(slot);
+    
+    // Complete the transaction and handle payment
+    finalize_transaction(slot->clerk, &slot->clerk->spin_budget, slot->customer, transaction);
+}
+
+/**
+ * Waits until the assistant has returned every job of the slot's customer.
+ * A coroutine yields to the clerk's other customers in the meantime.
+ */
+static void wait_for_slot_jobs(clerk_slot_t* slot) {
+    if (slot->pending_jobs == 0) {
+        return;
+    }
+    
+    #if ENABLE_STATS
+    long long wait_start_ns = now_ns();
+    #endif
+    
+    if (CLERK_MAX_INFLIGHT == 1) {
+        long long blocked_start_ns = now_ns();
+        wait_for_clerk_jobs(slot->clerk->id, slot->pending_jobs);
+        slot->pending_jobs = 0; // Reset counter after waiting
+        __sync_fetch_and_add(&assistant_blocked_ns, now_ns() - blocked_start_ns);
+    } else {
+        // The clerk resumes us once the last job has been delivered
+        while (slot->pending_jobs > 0) {
+            coroutine_yield();
+        }
+    }
+    
+    #if ENABLE_STATS
+    latency_recorder_add(&job_wait_latency, now_ns() - wait_start_ns);
+    #endif
 }
 
 /**
@@ -115,22 +570,29 @@ static transaction_t* create_transaction(int shopping_list_size) {
 }
 
 /**
- * Process a single customer item request
+ * Process a single message from the customer
  * 
  * @return true if shopping is complete, false if more items remain
  */
-static bool process_customer_item(clerk_t* clerk, customer_t* customer, transaction_t* transaction) {
+static bool process_customer_item(clerk_slot_t* slot, transaction_t* transaction) {
+    clerk_t* clerk = slot->clerk;
+    customer_t* customer = slot->customer;
+    
     // Wait until customer is ready with an item request or has finished shopping
-    while (!customer->waiting_for_response && customer->current_item_index < customer->shopping_list_size) {
-        pthread_cond_wait(&customer->cond, &customer->mutex);
-    }
+    checkout_msg_t request;
+    channel_recv(&customer->checkout.to_clerk, &request, &clerk->spin_budget);
     
     // Check if customer has completed their shopping list
-    if (customer->current_item_index >= customer->shopping_list_size) {
+    if (request.type == MSG_DONE) {
         return true; // Shopping complete
     }
     
-    int product_id = customer->current_item;
+    #if ENABLE_ASSERTS
+    assert(request.type == MSG_ITEM_REQUEST);
+    assert(transaction->items_size < customer->shopping_list_size);
+    #endif
+    
+    int product_id = request.product_id;
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -140,25 +602,31 @@ static bool process_customer_item(clerk_t* clerk, customer_t* customer, transact
     #endif
     
     // Process the requested item
-    bool in_stock = try_get_product(product_id);
+    bool in_stock = try_get_product(clerk->id, product_id);
+    metrics_add(&items_scanned_metric, 1);
     
     if (in_stock) {
-        int price = get_product_price(product_id);
-        transaction->total += price;
+        // The basket is priced as a whole when the transaction is finalized
         transaction->items[transaction->items_size++] = product_id;
         
         // If this product needs assistant preparation
         if (product_needs_assistant(product_id)) {
             // Create a new job for the assistant
             assistant_job_t* job = create_assistant_job(product_id, clerk->id);
+            job->slot = slot->index;
             
-            // Increment pending jobs counter
-            clerk->pending_jobs++;
+            // Increment pending jobs counter, remembering when we started waiting
+            if (slot->pending_jobs++ == 0) {
+                slot->jobs_since_ns = job->deadline_ns;
+            }
+            job->deadline_ns = slot->jobs_since_ns;
             
             // Add job to assistant queue
-            queue_push(assistant_queue, job);
+            assistant_submit_job(job);
         }
     } else {
+        metrics_add(&stockouts_metric, 1);
+        
         #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
         printf("Product %d out of stock for customer %d\n", product_id, customer->id);
@@ -166,9 +634,9 @@ static bool process_customer_item(clerk_t* clerk, customer_t* customer, transact
         #endif
     }
     
-    // Signal customer we've processed this item
-    customer->waiting_for_response = false;
-    pthread_cond_signal(&customer->cond);
+    // Tell the customer we've processed this item
+    checkout_msg_t response = { .type = MSG_ITEM_RESPONSE, .product_id = product_id, .in_stock = in_stock };
+    channel_send(&customer->checkout.to_customer, &response, &clerk->spin_budget);
     
     return false; // More items may remain
 }
@@ -176,33 +644,32 @@ static bool process_customer_item(clerk_t* clerk, customer_t* customer, transact
 /**
  * Finalizes the transaction, gives the receipt and collects payment
  */
-static void finalize_transaction(clerk_t* clerk, customer_t* customer, transaction_t* transaction) {
-    // Transaction complete, give receipt to customer
-    customer->receipt = transaction;
-    
+static void finalize_transaction(clerk_t* clerk, spin_budget_t* spin_budget,
+                                 customer_t* customer, transaction_t* transaction) {
     #if ENABLE_PRINTING || ENABLE_ASSERTS
     int customer_wallet = customer->wallet;
     #endif
     
-    // Signal customer about receipt and wait for payment
-    pthread_cond_signal(&customer->cond);
+    // Price the whole basket at once, with promotions and the customer's coupon
+    transaction->total = pricing_price_basket(transaction->items, transaction->items_size, customer->coupon);
+    
+    // Transaction complete, give receipt to customer and wait for payment
+    checkout_msg_t receipt = { .type = MSG_RECEIPT, .receipt = transaction };
+    channel_send(&customer->checkout.to_customer, &receipt, spin_budget);
     
-    // Wait for payment
+    #if ENABLE_PRINTING
     if (transaction->total > 0) {
-        #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
         printf("Clerk %d is waiting for customer %d to pay\n", clerk->id, customer->id);
         pthread_mutex_unlock(&printf_mutex);
-        #endif
-        
-        // Wait for customer to make payment
-        while (transaction->paid < transaction->total) {
-            pthread_cond_wait(&customer->cond, &customer->mutex);
-        }
-    } else {
-        // Even with zero total, wait for customer acknowledgment
-        pthread_cond_wait(&customer->cond, &customer->mutex);
     }
+    #endif
+    
+    // Wait for customer to make payment, even with zero total the
+    // customer acknowledges the receipt this way
+    checkout_msg_t payment;
+    channel_recv(&customer->checkout.to_clerk, &payment, spin_budget);
+    transaction->paid = payment.amount;
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -212,13 +679,16 @@ static void finalize_transaction(clerk_t* clerk, customer_t* customer, transacti
     #endif
 
     #if ENABLE_ASSERTS
+    assert(payment.type == MSG_PAYMENT);
     assert(transaction->total >= 0);
     assert(transaction->paid == transaction->total);
     assert(customer_wallet - transaction->total == customer->wallet);
     #endif
 
     // Update the cash register
-    clerk->cash_register += transaction->paid;
+    clerk->cash_register += payment.amount;
+    metrics_add(&sales_cents_metric, payment.amount);
+    metrics_add(&customers_served_metric, 1);
 
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -226,11 +696,26 @@ static void finalize_transaction(clerk_t* clerk, customer_t* customer, transacti
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
-    // Signal customer transaction is complete
-    pthread_cond_signal(&customer->cond);
-    
-    // Signal that we're completely done with this customer
-    customer->transaction_complete = 1;
-    // Final signal to wake up customer if it's waiting
-    pthread_cond_signal(&customer->cond);
+    // Signal that we're completely done with this customer, after this
+    // the customer may free the receipt
+    checkout_msg_t done = { .type = MSG_DONE };
+    channel_send(&customer->checkout.to_customer, &done, spin_budget);
+}
+
+void clerk_report_reset() {
+    assistant_blocked_ns = 0;
+    customers_overlapped = 0;
+    scheduler_waits = 0;
+    peak_inflight = CLERK_SLOTS == 1 ? 1 : 0;
+}
+
+void clerk_report() {
+    printf("[stats] clerks: max_inflight=%d pipeline_depth=%d peak_inflight=%d overlapped=%d "
+           "assistant_blocked=%.3fms\n",
+           CLERK_MAX_INFLIGHT, CLERK_PIPELINE_DEPTH, peak_inflight, customers_overlapped,
+           assistant_blocked_ns / 1e6);
+    if (CLERK_MAX_INFLIGHT > 1) {
+        printf("[stats] clerks: wait=%s waits=%d\n",
+               CLERK_WAIT_MODE == CLERK_WAIT_EPOLL ? "epoll" : "condvar", scheduler_waits);
+    }
 }
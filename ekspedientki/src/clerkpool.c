@@ -0,0 +1,268 @@
+#include "clerkpool.h"
+#include "clerk.h"
+#include "customer.h" // Include for printf_mutex
+#include "stats.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lockprof.h"
+
+/**
+ * States of a clerk lane.
+ */
+typedef enum lane_state_t {
+    LANE_CLOSED,     // No customers, clerk sleeps
+    LANE_OPEN,       // Customers may join
+    LANE_CLOSING     // No new customers, clerk serves the ones in its queue
+} lane_state_t;
+
+/* Global Variables */
+static int lane_state[NUM_CLERKS];            // lane_state_t, written by the manager
+static int lane_busy[NUM_CLERKS];             // Written by the lane's clerk
+static long long staffed_since_ns[NUM_CLERKS];
+static long long max_wait_ns = 0;             // Longest queue wait since the last look
+
+static pthread_t manager_thread_id;
+static bool manager_running = false;          // Cleared to stop the manager
+static bool manager_started = false;          // Whether there is a thread to join
+
+/* Pool statistics, written by the manager thread or by the main thread when it is not running */
+static long long pool_start_ns = 0;
+static long long pool_stop_ns = 0;
+static long long staffed_ns = 0;              // Clerk-time of lanes that were staffed
+static int lanes_opened = 0;
+static int lanes_closed = 0;
+static int peak_open = 0;
+
+/* Routing statistics, updated atomically by customers */
+static int express_baskets = 0;              // Customers allowed in express lanes
+static int express_routed = 0;               // Customers who joined an express lane
+
+/**
+ * Starts counting a lane as staffed.
+ */
+static void staff_lane(int lane, lane_state_t state, long long now) {
+    staffed_since_ns[lane] = now;
+    __atomic_store_n(&lane_state[lane], state, __ATOMIC_RELEASE);
+}
+
+/**
+ * Stops counting a lane as staffed.
+ */
+static void unstaff_lane(int lane, long long now) {
+    staffed_ns += now - staffed_since_ns[lane];
+    __atomic_store_n(&lane_state[lane], LANE_CLOSED, __ATOMIC_RELEASE);
+}
+
+/**
+ * Finishes closing lanes whose clerks are done, and staffs closed lanes
+ * again if a customer joined them just before they closed.
+ */
+static void settle_lanes(long long now) {
+    for (int lane = 0; lane < NUM_CLERKS; lane++) {
+        bool idle = customer_queue_size(clerk_queues[lane]) == 0 &&
+                    !__atomic_load_n(&lane_busy[lane], __ATOMIC_ACQUIRE);
+        if (lane_state[lane] == LANE_CLOSING && idle) {
+            unstaff_lane(lane, now);
+            lanes_closed++;
+        } else if (lane_state[lane] == LANE_CLOSED && !idle) {
+            staff_lane(lane, LANE_CLOSING, now);
+        }
+    }
+}
+
+/**
+ * Opens another lane, preferring one still closing since its clerk is there.
+ */
+static void open_lane(long long now) {
+    int chosen = -1;
+    for (int lane = 0; lane < NUM_CLERKS && chosen < 0; lane++) {
+        if (lane_state[lane] == LANE_CLOSING) {
+            chosen = lane;
+        }
+    }
+    if (chosen >= 0) {
+        __atomic_store_n(&lane_state[chosen], LANE_OPEN, __ATOMIC_RELEASE);
+    } else {
+        for (int lane = 0; lane < NUM_CLERKS && chosen < 0; lane++) {
+            if (lane_state[lane] == LANE_CLOSED) {
+                chosen = lane;
+                staff_lane(lane, LANE_OPEN, now);
+            }
+        }
+    }
+    lanes_opened++;
+
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Clerk %d opens a lane\n", chosen);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+}
+
+/**
+ * Starts closing the open lane with the highest clerk ID.
+ */
+static void close_lane() {
+    for (int lane = NUM_CLERKS - 1; lane >= 0; lane--) {
+        if (lane_state[lane] == LANE_OPEN) {
+            __atomic_store_n(&lane_state[lane], LANE_CLOSING, __ATOMIC_RELEASE);
+
+            #if ENABLE_PRINTING
+            pthread_mutex_lock(&printf_mutex);
+            printf("Clerk %d closes a lane\n", lane);
+            pthread_mutex_unlock(&printf_mutex);
+            #endif
+            return;
+        }
+    }
+}
+
+/**
+ * Main function for the pool manager thread.
+ */
+static void* manager_thread(void* arg) {
+    (void)arg;
+    int quiet_intervals = 0;
+    struct timespec interval = {
+        .tv_sec = CLERK_POOL_INTERVAL_US / 1000000,
+        .tv_nsec = (CLERK_POOL_INTERVAL_US % 1000000) * 1000L
+    };
+
+    while (__atomic_load_n(&manager_running, __ATOMIC_ACQUIRE)) {
+        nanosleep(&interval, NULL);
+        long long now = now_ns();
+        settle_lanes(now);
+
+        int open = 0;
+        int waiting = 0;
+        for (int lane = 0; lane < NUM_CLERKS; lane++) {
+            if (lane_state[lane] == LANE_OPEN) {
+                open++;
+                waiting += customer_queue_size_approx(clerk_queues[lane]);
+            }
+        }
+        long long longest_wait_ns = __atomic_exchange_n(&max_wait_ns, 0, __ATOMIC_RELAXED);
+        bool slow = longest_wait_ns >= CLERK_OPEN_WAIT_US * 1000LL;
+
+        if (open < NUM_CLERKS && (waiting >= CLERK_OPEN_QUEUE_LENGTH * open || slow)) {
+            open_lane(now);
+            open++;
+            quiet_intervals = 0;
+        } else if (open > MIN_OPEN_CLERKS && waiting <= CLERK_CLOSE_QUEUE_LENGTH * open && !slow) {
+            if (++quiet_intervals >= CLERK_CLOSE_INTERVALS) {
+                close_lane();
+                open--;
+                quiet_intervals = 0;
+            }
+        } else {
+            quiet_intervals = 0;
+        }
+        peak_open = open > peak_open ? open : peak_open;
+    }
+    return NULL;
+}
+
+void clerk_pool_start() {
+    if (NUM_EXPRESS_LANES >= NUM_CLERKS) {
+        fprintf(stderr, "Error: NUM_EXPRESS_LANES (%d) leaves no regular lane among %d clerks\n",
+                NUM_EXPRESS_LANES, NUM_CLERKS);
+        exit(1);
+    }
+    int initial = CLERK_POOL_MODE == CLERK_POOL_ELASTIC ? MIN_OPEN_CLERKS : NUM_CLERKS;
+    pool_start_ns = now_ns();
+    staffed_ns = 0;
+    lanes_opened = 0;
+    lanes_closed = 0;
+    peak_open = initial;
+    max_wait_ns = 0;
+    express_baskets = 0;
+    express_routed = 0;
+    for (int lane = 0; lane < NUM_CLERKS; lane++) {
+        lane_busy[lane] = false;
+        if (lane < initial) {
+            staff_lane(lane, LANE_OPEN, pool_start_ns);
+        } else {
+            lane_state[lane] = LANE_CLOSED;
+        }
+    }
+
+    manager_started = false;
+    if (CLERK_POOL_MODE != CLERK_POOL_ELASTIC) {
+        return;
+    }
+    manager_running = true;
+    int result = pthread_create(&manager_thread_id, NULL, manager_thread, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to create clerk pool manager thread, error: %d\n", result);
+        exit(1);
+    }
+    manager_started = true;
+}
+
+void clerk_pool_stop() {
+    if (manager_started) {
+        __atomic_store_n(&manager_running, false, __ATOMIC_RELEASE);
+        int result = pthread_join(manager_thread_id, NULL);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to join clerk pool manager thread, error: %d\n", result);
+            exit(1);
+        }
+        manager_started = false;
+    }
+
+    // Every customer has left, so every staffed lane is done now
+    pool_stop_ns = now_ns();
+    for (int lane = 0; lane < NUM_CLERKS; lane++) {
+        if (lane_state[lane] != LANE_CLOSED) {
+            unstaff_lane(lane, pool_stop_ns);
+        }
+    }
+}
+
+bool clerk_pool_lane_open(int lane) {
+    return __atomic_load_n(&lane_state[lane], __ATOMIC_ACQUIRE) == LANE_OPEN;
+}
+
+bool clerk_pool_lane_express(int lane) {
+    return lane >= NUM_CLERKS - NUM_EXPRESS_LANES;
+}
+
+void clerk_pool_record_route(bool express_basket, int lane) {
+    if (express_basket) {
+        __sync_fetch_and_add(&express_baskets, 1);
+    }
+    if (clerk_pool_lane_express(lane)) {
+        __sync_fetch_and_add(&express_routed, 1);
+    }
+}
+
+void clerk_pool_set_busy(int lane, bool busy) {
+    __atomic_store_n(&lane_busy[lane], busy, __ATOMIC_RELEASE);
+}
+
+void clerk_pool_record_wait(long long wait_ns) {
+    if (CLERK_POOL_MODE != CLERK_POOL_ELASTIC) {
+        return;
+    }
+    long long current = __atomic_load_n(&max_wait_ns, __ATOMIC_RELAXED);
+    while (wait_ns > current &&
+           !__atomic_compare_exchange_n(&max_wait_ns, &current, wait_ns, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void clerk_pool_report(int customers_served) {
+    double elapsed_s = (pool_stop_ns - pool_start_ns) / 1e9;
+    double clerk_seconds = staffed_ns / 1e9;
+    printf("[stats] clerks: pool=%s lanes=%d avg_open=%.2f peak_open=%d opened=%d closed=%d "
+           "clerk_seconds=%.4f served_per_clerk_second=%.1f\n",
+           CLERK_POOL_MODE == CLERK_POOL_ELASTIC ? "elastic" : "fixed", NUM_CLERKS,
+           elapsed_s > 0 ? clerk_seconds / elapsed_s : 0.0, peak_open, lanes_opened, lanes_closed,
+           clerk_seconds, clerk_seconds > 0 ? customers_served / clerk_seconds : 0.0);
+    if (NUM_EXPRESS_LANES > 0) {
+        printf("[stats] clerks: express_lanes=%d max_items=%d express_baskets=%d joined_express=%d\n",
+               NUM_EXPRESS_LANES, EXPRESS_MAX_ITEMS, express_baskets, express_routed);
+    }
+}
@@ -0,0 +1,64 @@
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Coroutine running on the calling thread, NULL outside coroutines */
+static __thread coroutine_t* current = NULL;
+
+/**
+ * Entry point of every coroutine: runs the body, then marks it finished
+ * and returns to the resuming thread through uc_link.
+ */
+static void trampoline() {
+    coroutine_t* co = current;
+    co->fn(co->arg);
+    co->finished = true;
+}
+
+void coroutine_init(coroutine_t* co, size_t stack_size) {
+    co->stack = malloc(stack_size);
+    if (co->stack == NULL) {
+        fprintf(stderr, "Error: malloc failed for coroutine stack\n");
+        exit(1);
+    }
+    co->stack_size = stack_size;
+    co->finished = true;
+}
+
+void coroutine_start(coroutine_t* co, coroutine_fn fn, void* arg) {
+    if (getcontext(&co->context) != 0) {
+        fprintf(stderr, "Error: getcontext failed for coroutine\n");
+        exit(1);
+    }
+    co->context.uc_stack.ss_sp = co->stack;
+    co->context.uc_stack.ss_size = co->stack_size;
+    co->context.uc_link = &co->caller;
+    makecontext(&co->context, trampoline, 0);
+    co->fn = fn;
+    co->arg = arg;
+    co->finished = false;
+}
+
+bool coroutine_resume(coroutine_t* co) {
+    coroutine_t* previous = current;
+    current = co;
+    if (swapcontext(&co->caller, &co->context) != 0) {
+        fprintf(stderr, "Error: swapcontext failed for coroutine\n");
+        exit(1);
+    }
+    current = previous;
+    return co->finished;
+}
+
+void coroutine_yield() {
+    coroutine_t* co = current;
+    if (swapcontext(&co->context, &co->caller) != 0) {
+        fprintf(stderr, "Error: swapcontext failed for coroutine\n");
+        exit(1);
+    }
+}
+
+void coroutine_destroy(coroutine_t* co) {
+    free(co->stack);
+    co->stack = NULL;
+}
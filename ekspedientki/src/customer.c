@@ -1,23 +1,33 @@
 #include "customer.h"
-#include "queue.h"
 #include "parameters.h"
 #include "shop.h"
+#include "placement.h"
+#include "perfcount.h"
+#include "clerkpool.h"
+#include "product.h"
+#include "kiosk.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include "lockprof.h"
 
 // External references to global variables
-extern pthread_mutex_t queue_mutex;
 extern int customers_remaining;
-extern queue* clerk_queues[];
+extern customer_queue_t* clerk_queues[];
 
 // Global mutex for synchronized printing
 pthread_mutex_t printf_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+IQUEUE_DEFINE(customer_queue, customer_t, queue_next)
+
 // Forward declarations of helper functions
-static int find_shortest_queue(void);
-static void request_items(customer_t* customer);
-static void process_payment(customer_t* customer);
+static int find_shortest_queue(bool express_basket);
+static bool checkout_with_clerk(customer_t* customer, int clerk_idx, bool express_basket);
+static bool self_checkout(customer_t* customer);
+static bool wait_for_clerk(customer_t* customer, customer_queue_t* clerk_queue, checkout_msg_t* response);
+static bool request_items(customer_t* customer, customer_queue_t* clerk_queue);
+static void process_payment(customer_t* customer, const checkout_msg_t* receipt);
 static void cleanup_resources(customer_t* customer);
 
 /**
@@ -26,11 +36,11 @@ static void cleanup_resources(customer_t* customer);
 void* customer_thread(void* arg) {
     customer_t* self = (customer_t*)arg;
 
+    perf_thread_begin(PERF_ROLE_CUSTOMER);
+
     // Initialize customer status
-    self->current_item_index = 0;
-    self->waiting_for_response = false;
-    self->clerk_ready = false;
-    self->transaction_complete = 0;
+    self->transaction_complete = false;
+    spin_budget_init(&self->spin_budget);
     
     #if ENABLE_ASSERTS
     assert(self != NULL);
@@ -46,44 +56,37 @@ void* customer_thread(void* arg) {
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
-    // Find and join the shortest queue
-    int shortest_queue_idx = find_shortest_queue();
-    
-    #if ENABLE_PRINTING
-    pthread_mutex_lock(&printf_mutex);
-    printf("Customer %d is joining queue %d\n", self->id, shortest_queue_idx);
-    pthread_mutex_unlock(&printf_mutex);
-    #endif
-    
-    queue_push(clerk_queues[shortest_queue_idx], self);
-    
-    // Begin shopping process
-    pthread_mutex_lock(&self->mutex);
+    // Small baskets go to the self-checkout kiosks, the others find the
+    // shortest clerk queue they may join. Leave if even that one is too long.
+    bool kiosk_basket = NUM_KIOSKS > 0 && self->shopping_list_size <= KIOSK_MAX_ITEMS;
+    bool express_basket = self->shopping_list_size <= EXPRESS_MAX_ITEMS &&
+                          count_assistant_items(self->shopping_list, self->shopping_list_size) == 0;
+    int shortest_queue_idx = kiosk_basket ? -1 : find_shortest_queue(express_basket);
+    customer_queue_t* chosen_queue = kiosk_basket ? kiosk_queue : clerk_queues[shortest_queue_idx];
     
-    // Wait for clerk to be ready to serve us
-    while (!self->clerk_ready) {
+    // Every kiosk worker serves the kiosk queue, so it moves that many times faster
+    int balk_length = kiosk_basket ? BALK_QUEUE_LENGTH * NUM_KIOSKS : BALK_QUEUE_LENGTH;
+    if (BALK_QUEUE_LENGTH > 0 && customer_queue_size_approx(chosen_queue) >= balk_length) {
+        self->outcome = CUSTOMER_BALKED;
+        
         #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
-        printf("Customer %d is waiting for a clerk\n", self->id);
+        printf("Customer %d finds every queue too long and leaves\n", self->id);
         pthread_mutex_unlock(&printf_mutex);
         #endif
+    } else if (kiosk_basket ? self_checkout(self)
+                            : checkout_with_clerk(self, shortest_queue_idx, express_basket)) {
+        self->outcome = CUSTOMER_SERVED;
         
-        pthread_cond_wait(&self->cond, &self->mutex);
+        #if ENABLE_STATS
+        long long latency_ns = now_ns() - self->arrival_ns;
+        latency_recorder_add(&customer_latency, latency_ns);
+        latency_recorder_add(&basket_latency[self->shopping_list_size - 1], latency_ns);
+        #endif
+    } else {
+        self->outcome = CUSTOMER_ABANDONED;
     }
-    
-    #if ENABLE_PRINTING
-    pthread_mutex_lock(&printf_mutex);
-    printf("Customer %d is now being served\n", self->id);
-    pthread_mutex_unlock(&printf_mutex);
-    #endif
-    
-    // Request items one by one
-    request_items(self);
-    
-    // Process payment
-    process_payment(self);
-    
-    pthread_mutex_unlock(&self->mutex);
+    record_customer_outcome(self->outcome);
 
     // Update remaining customers count
     pthread_mutex_lock(&customers_mutex);
@@ -97,9 +100,9 @@ void* customer_thread(void* arg) {
         pthread_mutex_unlock(&printf_mutex);
         #endif
         
-        // Add sentinel to all queues to signal clerks to stop
+        // Close all queues to signal clerks to stop
         for (int i = 0; i < NUM_CLERKS; i++) {
-            queue_push(clerk_queues[i], SENTINEL_VALUE);
+            customer_queue_close(clerk_queues[i]);
         }
     }
     pthread_mutex_unlock(&customers_mutex);
@@ -114,6 +117,8 @@ void* customer_thread(void* arg) {
     // Clean up resources
     cleanup_resources(self);
     
+    perf_thread_end();
+
     // Signal that a customer has exited, allowing a new one to enter
     signal_customer_exit();
 
@@ -121,85 +126,206 @@ void* customer_thread(void* arg) {
 }
 
 /**
- * Finds the clerk queue with the fewest waiting customers
+ * Finds the open clerk queue with the fewest waiting customers. Express
+ * lanes are only offered to small baskets, which look at them first so
+ * they win ties against regular lanes. The sizes are read without
+ * locking, so the choice may be slightly stale, as it would be anyway by
+ * the time the customer joins the queue.
+ * 
+ * @param express_basket Whether the customer may use express lanes
  */
-static int find_shortest_queue(void) {
-    pthread_mutex_lock(&queue_mutex);
-    
+static int find_shortest_queue(bool express_basket) {
     int shortest_queue_idx = 0;
-    int shortest_length = queue_size(clerk_queues[0]);
+    int shortest_length = -1;
     
-    for (int i = 1; i < NUM_CLERKS; i++) {
-        int current_length = queue_size(clerk_queues[i]);
-        if (current_length < shortest_length) {
+    for (int k = 0; k < NUM_CLERKS; k++) {
+        // Express lanes have the highest IDs
+        int i = express_basket ? NUM_CLERKS - 1 - k : k;
+        if (!clerk_pool_lane_open(i) || (!express_basket && clerk_pool_lane_express(i))) {
+            continue;
+        }
+        int current_length = customer_queue_size_approx(clerk_queues[i]);
+        if (shortest_length < 0 || current_length < shortest_length) {
             shortest_length = current_length;
             shortest_queue_idx = i;
         }
     }
     
-    pthread_mutex_unlock(&queue_mutex);
     return shortest_queue_idx;
 }
 
+/**
+ * Joins a clerk queue, has every item scanned and pays.
+ *
+ * @return true if the customer was served, false if they left the queue first
+ */
+static bool checkout_with_clerk(customer_t* customer, int clerk_idx, bool express_basket) {
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Customer %d is joining queue %d\n", customer->id, clerk_idx);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    // Run next to the clerk that will serve us
+    placement_pin_customer(clerk_idx);
+    clerk_pool_record_route(express_basket, clerk_idx);
+    
+    customer->queued_ns = now_ns();
+    customer_queue_push(clerk_queues[clerk_idx], customer);
+    
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Customer %d is waiting for a clerk\n", customer->id);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    // Request items one by one, the clerk answers once it serves us
+    if (!request_items(customer, clerk_queues[clerk_idx])) {
+        return false;
+    }
+    
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Customer %d waiting for receipt\n", customer->id);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    checkout_msg_t receipt;
+    channel_recv(&customer->checkout.to_customer, &receipt, &customer->spin_budget);
+    process_payment(customer, &receipt);
+    return true;
+}
+
+/**
+ * Puts the whole basket in a transaction of our own, joins the kiosk queue
+ * and pays. The kiosk drops the items that are out of stock.
+ *
+ * @return true if the customer was served, false if they left the queue first
+ */
+static bool self_checkout(customer_t* customer) {
+    transaction_t* transaction = malloc(sizeof(transaction_t));
+    if (transaction == NULL) {
+        fprintf(stderr, "Error: malloc failed for transaction\n");
+        exit(1);
+    }
+    transaction->paid = 0;
+    transaction->total = 0;
+    transaction->items_size = customer->shopping_list_size;
+    transaction->items = malloc(sizeof(int) * customer->shopping_list_size);
+    if (transaction->items == NULL) {
+        fprintf(stderr, "Error: malloc failed for transaction items\n");
+        exit(1);
+    }
+    memcpy(transaction->items, customer->shopping_list, sizeof(int) * customer->shopping_list_size);
+    customer->receipt = transaction;
+    
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Customer %d is joining the self-checkout queue\n", customer->id);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    customer->queued_ns = now_ns();
+    customer_queue_push(kiosk_queue, customer);
+    
+    // The kiosk answers with the receipt once it has scanned the basket
+    checkout_msg_t receipt;
+    if (!wait_for_clerk(customer, kiosk_queue, &receipt)) {
+        return false;
+    }
+    process_payment(customer, &receipt);
+    return true;
+}
+
+/**
+ * Waits for the clerk's answer to the first item request, or the kiosk's
+ * receipt, which only comes once a clerk or kiosk picks the customer from
+ * the queue. If the customer's patience runs out first, the customer
+ * leaves the queue, unless a clerk took them in the meantime, in which
+ * case they stay until served.
+ *
+ * @return true if the customer is being served, false if they left the queue
+ */
+static bool wait_for_clerk(customer_t* customer, customer_queue_t* clerk_queue, checkout_msg_t* response) {
+    if (channel_recv_until(&customer->checkout.to_customer, response, &customer->spin_budget,
+                           customer->patience_deadline_ns)) {
+        return true;
+    }
+    if (customer_queue_remove(clerk_queue, customer)) {
+        #if ENABLE_PRINTING
+        pthread_mutex_lock(&printf_mutex);
+        printf("Customer %d ran out of patience and leaves the queue\n", customer->id);
+        pthread_mutex_unlock(&printf_mutex);
+        #endif
+        return false;
+    }
+    channel_recv(&customer->checkout.to_customer, response, &customer->spin_budget);
+    return true;
+}
+
 /**
  * Requests each item on the customer's shopping list
+ *
+ * @return true once every item was answered, false if the customer left the queue first
  */
-static void request_items(customer_t* customer) {
-    for (customer->current_item_index = 0; 
-         customer->current_item_index < customer->shopping_list_size; 
-         customer->current_item_index++) {
-         
-        // Set the current item to request
-        customer->current_item = customer->shopping_list[customer->current_item_index];
+static bool request_items(customer_t* customer, customer_queue_t* clerk_queue) {
+    for (int index = 0; index < customer->shopping_list_size; index++) {
+        checkout_msg_t request = { .type = MSG_ITEM_REQUEST, .product_id = customer->shopping_list[index] };
         
         #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
-        printf("Customer %d requesting item %d\n", customer->id, customer->current_item);
+        printf("Customer %d requesting item %d\n", customer->id, request.product_id);
         pthread_mutex_unlock(&printf_mutex);
         #endif
         
-        // Signal the clerk we have a request
-        customer->waiting_for_response = true;
-        pthread_cond_signal(&customer->cond);
+        #if ENABLE_STATS
+        long long requested_ns = now_ns();
+        #endif
         
-        // Wait for clerk to process our request
-        while (customer->waiting_for_response) {
-            #if ENABLE_PRINTING
-            pthread_mutex_lock(&printf_mutex);
-            printf("Customer %d waiting for clerk to process item %d\n", 
-                  customer->id, customer->current_item);
-            pthread_mutex_unlock(&printf_mutex);
-            #endif
-            
-            pthread_cond_wait(&customer->cond, &customer->mutex);
+        // Send the request and wait for clerk to process it
+        checkout_msg_t response;
+        channel_send(&customer->checkout.to_clerk, &request, &customer->spin_budget);
+        if (index == 0) {
+            if (!wait_for_clerk(customer, clerk_queue, &response)) {
+                return false;
+            }
+        } else {
+            channel_recv(&customer->checkout.to_customer, &response, &customer->spin_budget);
         }
         
+        // The first request is sent before a clerk picks us, so its answer
+        // also waits for the queue and is kept apart from the handshakes
+        #if ENABLE_STATS
+        latency_recorder_add(index == 0 ? &first_item_latency : &item_latency, now_ns() - requested_ns);
+        #endif
+        
+        #if ENABLE_ASSERTS
+        assert(response.type == MSG_ITEM_RESPONSE);
+        assert(response.product_id == request.product_id);
+        #endif
+        
         #if ENABLE_PRINTING
         pthread_mutex_lock(&printf_mutex);
-        printf("Customer %d received response for item %d\n", 
-               customer->id, customer->shopping_list[customer->current_item_index]);
+        if (index == 0) {
+            printf("Customer %d is now being served\n", customer->id);
+        }
+        printf("Customer %d received response for item %d (%s)\n", 
+               customer->id, response.product_id, response.in_stock ? "in stock" : "out of stock");
         pthread_mutex_unlock(&printf_mutex);
         #endif
-        
-        // Signal we're ready for the next item or for payment
-        pthread_cond_signal(&customer->cond);
     }
+    
+    // Tell the clerk we're ready for payment
+    checkout_msg_t done = { .type = MSG_DONE };
+    channel_send(&customer->checkout.to_clerk, &done, &customer->spin_budget);
+    return true;
 }
 
 /**
  * Processes the receipt and makes payment
  */
-static void process_payment(customer_t* customer) {
-    // Wait for receipt from clerk
-    while (customer->receipt == NULL) {
-        #if ENABLE_PRINTING
-        pthread_mutex_lock(&printf_mutex);
-        printf("Customer %d waiting for receipt\n", customer->id);
-        pthread_mutex_unlock(&printf_mutex);
-        #endif
-        
-        pthread_cond_wait(&customer->cond, &customer->mutex);
-    }
+static void process_payment(customer_t* customer, const checkout_msg_t* receipt) {
+    customer->receipt = receipt->receipt;
 
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -210,18 +336,13 @@ static void process_payment(customer_t* customer) {
 
     #if ENABLE_ASSERTS
     // Verify receipt is valid
+    assert(receipt->type == MSG_RECEIPT);
     assert(customer->receipt != NULL);
     assert(customer->receipt->total >= 0);
     #endif
 
     // Make payment
     customer->wallet -= customer->receipt->total;
-    customer->receipt->paid = customer->receipt->total;
-
-    #if ENABLE_ASSERTS
-    // Verify payment was made correctly
-    assert(customer->receipt->paid == customer->receipt->total);
-    #endif
 
     // Signal the clerk that payment has been made
     #if ENABLE_PRINTING
@@ -230,12 +351,17 @@ static void process_payment(customer_t* customer) {
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
-    pthread_cond_signal(&customer->cond);
+    checkout_msg_t payment = { .type = MSG_PAYMENT, .amount = customer->receipt->total };
+    channel_send(&customer->checkout.to_clerk, &payment, &customer->spin_budget);
 
     // Wait for clerk to mark transaction as complete
-    while (!customer->receipt->paid || !customer->transaction_complete) {
-        pthread_cond_wait(&customer->cond, &customer->mutex);
-    }
+    checkout_msg_t done;
+    channel_recv(&customer->checkout.to_customer, &done, &customer->spin_budget);
+    
+    #if ENABLE_ASSERTS
+    assert(done.type == MSG_DONE);
+    #endif
+    customer->transaction_complete = true;
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
@@ -249,14 +375,10 @@ static void process_payment(customer_t* customer) {
  */
 static void cleanup_resources(customer_t* customer) {
     // Check if transaction is complete before cleanup
-    pthread_mutex_lock(&customer->mutex);
     #if ENABLE_ASSERTS
-    assert(customer->transaction_complete && "Customer attempting cleanup before transaction complete");
+    assert((customer->transaction_complete || customer->outcome != CUSTOMER_SERVED) &&
+           "Customer attempting cleanup before transaction complete");
     #endif
-    pthread_mutex_unlock(&customer->mutex);
-    
-    // Don't destroy mutex or condition variable here to avoid a race condition
-    // They will be destroyed in shop.c after all threads join
     
     #if ENABLE_ASSERTS
     if (customer->receipt != NULL) {
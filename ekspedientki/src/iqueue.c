@@ -0,0 +1,80 @@
+#include "iqueue.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "lockprof.h"
+
+void iqueue_state_init(iqueue_state_t* state) {
+    pthread_mutex_init(&state->lock, NULL);
+    pthread_cond_init(&state->cond, NULL);
+    state->size = 0;
+    state->closed = false;
+    state->event_fd = -1;
+}
+
+void iqueue_state_destroy(iqueue_state_t* state) {
+    if (state->event_fd >= 0) {
+        close(state->event_fd);
+    }
+    pthread_mutex_destroy(&state->lock);
+    pthread_cond_destroy(&state->cond);
+}
+
+void iqueue_state_set_size(iqueue_state_t* state, int size) {
+    __atomic_store_n(&state->size, size, __ATOMIC_RELAXED);
+}
+
+void iqueue_state_close(iqueue_state_t* state) {
+    pthread_mutex_lock(&state->lock);
+    state->closed = true;
+    pthread_cond_broadcast(&state->cond);
+    int event_fd = state->event_fd;
+    pthread_mutex_unlock(&state->lock);
+    iqueue_notify(event_fd);
+}
+
+int iqueue_state_size(iqueue_state_t* state) {
+    pthread_mutex_lock(&state->lock);
+    int size = state->size;
+    pthread_mutex_unlock(&state->lock);
+    return size;
+}
+
+int iqueue_state_size_approx(iqueue_state_t* state) {
+    return __atomic_load_n(&state->size, __ATOMIC_RELAXED);
+}
+
+int iqueue_state_event_fd(iqueue_state_t* state) {
+    pthread_mutex_lock(&state->lock);
+    if (state->event_fd < 0) {
+        unsigned int initial = (unsigned int)state->size + (state->closed ? 1 : 0);
+        state->event_fd = eventfd(initial, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (state->event_fd < 0) {
+            fprintf(stderr, "Error: eventfd failed for queue\n");
+            exit(1);
+        }
+    }
+    int event_fd = state->event_fd;
+    pthread_mutex_unlock(&state->lock);
+    return event_fd;
+}
+
+void iqueue_notify(int event_fd) {
+    if (event_fd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+        fprintf(stderr, "Error: write failed for queue eventfd\n");
+        exit(1);
+    }
+}
+
+void iqueue_event_clear(int event_fd) {
+    uint64_t count;
+    if (read(event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "Error: read failed for queue eventfd\n");
+        exit(1);
+    }
+}
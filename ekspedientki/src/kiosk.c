@@ -0,0 +1,202 @@
+#include "kiosk.h"
+#include "customer.h"
+#include "shop.h"  // Include for deposit_to_safe function
+#include "product.h"
+#include "pricing.h"
+#include "assistant.h"
+#include "admission.h"
+#include "perfcount.h"
+#include "stats.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "lockprof.h"
+
+/**
+ * Represents a kiosk worker.
+ */
+typedef struct kiosk_t {
+    int id;                    // Stock shard and inbox, NUM_CLERKS to NUM_CLERKS + NUM_KIOSKS - 1
+    int cash_register;         // Amount of money collected
+    int pending_jobs;          // Count of pending assistant jobs
+    long long jobs_since_ns;   // Time the oldest pending assistant job was submitted
+    spin_budget_t spin_budget; // Adaptive spin budget for customer handshakes
+} kiosk_t;
+
+/* Global Variables */
+customer_queue_t* kiosk_queue = NULL;
+static kiosk_t kiosks[NUM_KIOSKS > 0 ? NUM_KIOSKS : 1];
+static pthread_t kiosk_thread_ids[NUM_KIOSKS > 0 ? NUM_KIOSKS : 1];
+
+/* Kiosk statistics, updated atomically by the kiosk workers */
+static long long kiosks_start_ns = 0;
+static long long kiosks_stop_ns = 0;
+static int customers_checked_out = 0;
+static int items_requested = 0;
+static int items_sold = 0;
+static int assistant_jobs = 0;
+static long long busy_ns = 0;              // Time workers spent with a customer
+
+/**
+ * Reserves the customer's basket and sends its assistant products to the
+ * assistant, then waits for them.
+ */
+static void scan_basket(kiosk_t* kiosk, transaction_t* transaction) {
+    int requested = transaction->items_size;
+    transaction->items_size = reserve_basket(kiosk->id, transaction->items, requested);
+    metrics_add(&items_scanned_metric, requested);
+    metrics_add(&stockouts_metric, requested - transaction->items_size);
+    __sync_fetch_and_add(&items_requested, requested);
+    __sync_fetch_and_add(&items_sold, transaction->items_size);
+
+    for (int i = 0; i < transaction->items_size; i++) {
+        if (!product_needs_assistant(transaction->items[i])) {
+            continue;
+        }
+        assistant_job_t* job = create_assistant_job(transaction->items[i], kiosk->id);
+        if (kiosk->pending_jobs++ == 0) {
+            kiosk->jobs_since_ns = job->deadline_ns;
+        }
+        job->deadline_ns = kiosk->jobs_since_ns;
+        assistant_submit_job(job);
+    }
+
+    if (kiosk->pending_jobs > 0) {
+        __sync_fetch_and_add(&assistant_jobs, kiosk->pending_jobs);
+        wait_for_clerk_jobs(kiosk->id, kiosk->pending_jobs);
+        kiosk->pending_jobs = 0;
+    }
+}
+
+/**
+ * Prices the basket, gives the receipt and collects payment.
+ */
+static void take_payment(kiosk_t* kiosk, customer_t* customer, transaction_t* transaction) {
+    transaction->total = pricing_price_basket(transaction->items, transaction->items_size, customer->coupon);
+
+    checkout_msg_t receipt = { .type = MSG_RECEIPT, .receipt = transaction };
+    channel_send(&customer->checkout.to_customer, &receipt, &kiosk->spin_budget);
+
+    checkout_msg_t payment;
+    channel_recv(&customer->checkout.to_clerk, &payment, &kiosk->spin_budget);
+    transaction->paid = payment.amount;
+
+    #if ENABLE_ASSERTS
+    assert(payment.type == MSG_PAYMENT);
+    assert(transaction->paid == transaction->total);
+    #endif
+
+    kiosk->cash_register += payment.amount;
+    metrics_add(&sales_cents_metric, payment.amount);
+    metrics_add(&customers_served_metric, 1);
+
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Kiosk %d has been paid %d cents by customer %d\n",
+           kiosk->id - NUM_CLERKS, payment.amount, customer->id);
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+
+    // After this the customer may free the transaction
+    checkout_msg_t done = { .type = MSG_DONE };
+    channel_send(&customer->checkout.to_customer, &done, &kiosk->spin_budget);
+}
+
+/**
+ * Main function for a kiosk worker thread.
+ */
+static void* kiosk_thread(void* arg) {
+    kiosk_t* self = (kiosk_t*)arg;
+
+    perf_thread_begin(PERF_ROLE_KIOSK);
+    clerk_inboxes[self->id] = job_queue_create();
+
+    while (1) {
+        customer_t* customer = customer_queue_pop(kiosk_queue);
+        if (customer == NULL) {
+            break; // The queue is closed and drained
+        }
+
+        long long start_ns = now_ns();
+        admission_record_wait(start_ns - customer->queued_ns);
+
+        #if ENABLE_ASSERTS
+        assert(customer->receipt != NULL);
+        assert(customer->receipt->items_size == customer->shopping_list_size);
+        #endif
+
+        #if ENABLE_PRINTING
+        pthread_mutex_lock(&printf_mutex);
+        printf("Kiosk %d is checking out customer %d\n", self->id - NUM_CLERKS, customer->id);
+        pthread_mutex_unlock(&printf_mutex);
+        #endif
+
+        transaction_t* transaction = customer->receipt;
+        scan_basket(self, transaction);
+        take_payment(self, customer, transaction);
+
+        __sync_fetch_and_add(&customers_checked_out, 1);
+        __sync_fetch_and_add(&busy_ns, now_ns() - start_ns);
+    }
+
+    deposit_to_safe(self->cash_register);
+    perf_thread_end();
+    return NULL;
+}
+
+void kiosks_start() {
+    kiosks_start_ns = now_ns();
+    customers_checked_out = 0;
+    items_requested = 0;
+    items_sold = 0;
+    assistant_jobs = 0;
+    busy_ns = 0;
+    if (NUM_KIOSKS == 0) {
+        return;
+    }
+
+    kiosk_queue = customer_queue_create();
+    for (int k = 0; k < NUM_KIOSKS; k++) {
+        kiosks[k].id = NUM_CLERKS + k;
+        kiosks[k].cash_register = 0;
+        kiosks[k].pending_jobs = 0;
+        spin_budget_init(&kiosks[k].spin_budget);
+
+        int result = pthread_create(&kiosk_thread_ids[k], NULL, kiosk_thread, &kiosks[k]);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to create kiosk thread %d, error: %d\n", k, result);
+            exit(1);
+        }
+    }
+}
+
+void kiosks_stop() {
+    kiosks_stop_ns = now_ns();
+    if (NUM_KIOSKS == 0) {
+        return;
+    }
+
+    customer_queue_close(kiosk_queue);
+    for (int k = 0; k < NUM_KIOSKS; k++) {
+        int result = pthread_join(kiosk_thread_ids[k], NULL);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to join kiosk thread %d, error: %d\n", k, result);
+            exit(1);
+        }
+    }
+    customer_queue_destroy(kiosk_queue);
+    kiosk_queue = NULL;
+}
+
+void kiosk_report() {
+    if (NUM_KIOSKS == 0) {
+        return;
+    }
+    double kiosk_seconds = NUM_KIOSKS * (kiosks_stop_ns - kiosks_start_ns) / 1e9;
+    printf("[stats] kiosks: kiosks=%d max_items=%d customers=%d items=%d sold=%d assistant_jobs=%d "
+           "busy=%.1f%% served_per_kiosk_second=%.1f\n",
+           NUM_KIOSKS, KIOSK_MAX_ITEMS, customers_checked_out, items_requested, items_sold,
+           assistant_jobs, kiosk_seconds > 0 ? 100.0 * busy_ns / 1e9 / kiosk_seconds : 0.0,
+           kiosk_seconds > 0 ? customers_checked_out / kiosk_seconds : 0.0);
+}
@@ -0,0 +1,273 @@
+#include "lockprof.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This file calls the real functions, never the instrumented ones */
+#undef pthread_mutex_lock
+#undef pthread_mutex_unlock
+#undef pthread_cond_wait
+#undef pthread_cond_timedwait
+
+/** Most distinct locks the profiler tracks */
+#define MAX_LOCKS 32
+
+/** Longest lock name kept */
+#define LOCK_NAME_SIZE 48
+
+/** Histogram buckets, bucket b counts durations below 2^b nanoseconds */
+#define HISTOGRAM_BUCKETS 40
+
+/** Most locks one thread may hold at the same time */
+#define MAX_HELD_LOCKS 16
+
+struct lock_stats_t {
+    char name[LOCK_NAME_SIZE];
+    long acquisitions;                       // Times the lock was taken
+    long contended;                          // Times it was already held
+    long long wait_ns;                       // Total time spent waiting
+    long long hold_ns;                       // Total time it was held
+    long long max_wait_ns;
+    long long max_hold_ns;
+    long wait_histogram[HISTOGRAM_BUCKETS];  // Waits of contended acquisitions
+    long hold_histogram[HISTOGRAM_BUCKETS];  // One sample per release or condition wait
+};
+
+/**
+ * A lock held by the calling thread.
+ */
+typedef struct held_lock_t {
+    pthread_mutex_t* mutex;
+    lock_stats_t* stats;
+    long long acquired_ns;
+} held_lock_t;
+
+/* Global Variables */
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lock_stats_t locks[MAX_LOCKS];
+static int num_locks = 0;
+
+static __thread held_lock_t held[MAX_HELD_LOCKS];
+static __thread int num_held = 0;
+
+/**
+ * Derives the name of a lock from its call site: "&printf_mutex" becomes
+ * "printf_mutex" and "&q->lock" in src/queue.c becomes "queue.lock".
+ */
+static void lock_name(char* name, const char* expression, const char* file) {
+    if (*expression == '&') {
+        expression++;
+    }
+    const char* member = strrchr(expression, '>');
+    const char* dot = strrchr(expression, '.');
+    if (dot != NULL && (member == NULL || dot > member)) {
+        member = dot;
+    }
+    if (member == NULL) {
+        snprintf(name, LOCK_NAME_SIZE, "%s", expression);
+        return;
+    }
+    const char* base = strrchr(file, '/');
+    base = base != NULL ? base + 1 : file;
+    int base_length = (int)strcspn(base, ".");
+    snprintf(name, LOCK_NAME_SIZE, "%.*s.%s", base_length, base, member + 1);
+}
+
+lock_stats_t* lockprof_site(const char* expression, const char* file) {
+    char name[LOCK_NAME_SIZE];
+    lock_name(name, expression, file);
+
+    pthread_mutex_lock(&registry_mutex);
+    lock_stats_t* stats = NULL;
+    for (int i = 0; i < num_locks; i++) {
+        if (strcmp(locks[i].name, name) == 0) {
+            stats = &locks[i];
+            break;
+        }
+    }
+    if (stats == NULL) {
+        if (num_locks == MAX_LOCKS) {
+            fprintf(stderr, "Error: more than %d profiled locks\n", MAX_LOCKS);
+            exit(1);
+        }
+        stats = &locks[num_locks++];
+        memset(stats, 0, sizeof(*stats));
+        memcpy(stats->name, name, sizeof(name));
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return stats;
+}
+
+/**
+ * Gets the histogram bucket of a duration.
+ */
+static int bucket_of(long long ns) {
+    int bucket = ns > 0 ? 64 - __builtin_clzll((unsigned long long)ns) : 0;
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Raises a maximum without locking.
+ */
+static void update_max(long long* max, long long ns) {
+    long long current = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (ns > current &&
+           !__atomic_compare_exchange_n(max, &current, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Starts the hold time of a lock the calling thread has just taken.
+ */
+static void push_held(pthread_mutex_t* mutex, lock_stats_t* stats) {
+    if (num_held == MAX_HELD_LOCKS) {
+        fprintf(stderr, "Error: a thread holds more than %d locks\n", MAX_HELD_LOCKS);
+        exit(1);
+    }
+    held[num_held].mutex = mutex;
+    held[num_held].stats = stats;
+    held[num_held].acquired_ns = now_ns();
+    num_held++;
+}
+
+/**
+ * Ends the hold time of a lock the calling thread is about to release.
+ *
+ * @return Statistics of the lock, NULL if the thread did not take it through the profiler
+ */
+static lock_stats_t* pop_held(pthread_mutex_t* mutex) {
+    for (int i = num_held - 1; i >= 0; i--) {
+        if (held[i].mutex != mutex) {
+            continue;
+        }
+        lock_stats_t* stats = held[i].stats;
+        long long hold = now_ns() - held[i].acquired_ns;
+        __atomic_fetch_add(&stats->hold_ns, hold, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->hold_histogram[bucket_of(hold)], 1, __ATOMIC_RELAXED);
+        update_max(&stats->max_hold_ns, hold);
+        held[i] = held[--num_held];
+        return stats;
+    }
+    return NULL;
+}
+
+int lockprof_lock(pthread_mutex_t* mutex, lock_stats_t* stats) {
+    int result = pthread_mutex_trylock(mutex);
+    if (result == EBUSY) {
+        long long start = now_ns();
+        result = pthread_mutex_lock(mutex);
+        long long wait = now_ns() - start;
+        __atomic_fetch_add(&stats->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->wait_ns, wait, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->wait_histogram[bucket_of(wait)], 1, __ATOMIC_RELAXED);
+        update_max(&stats->max_wait_ns, wait);
+    }
+    if (result == 0) {
+        __atomic_fetch_add(&stats->acquisitions, 1, __ATOMIC_RELAXED);
+        push_held(mutex, stats);
+    }
+    return result;
+}
+
+int lockprof_unlock(pthread_mutex_t* mutex) {
+    pop_held(mutex);
+    return pthread_mutex_unlock(mutex);
+}
+
+int lockprof_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    lock_stats_t* stats = pop_held(mutex);
+    int result = pthread_cond_wait(cond, mutex);
+    if (stats != NULL) {
+        push_held(mutex, stats);
+    }
+    return result;
+}
+
+int lockprof_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                            const struct timespec* deadline) {
+    lock_stats_t* stats = pop_held(mutex);
+    int result = pthread_cond_timedwait(cond, mutex, deadline);
+    if (stats != NULL) {
+        push_held(mutex, stats);
+    }
+    return result;
+}
+
+void lockprof_reset() {
+    pthread_mutex_lock(&registry_mutex);
+    for (int i = 0; i < num_locks; i++) {
+        char name[LOCK_NAME_SIZE];
+        memcpy(name, locks[i].name, sizeof(name));
+        memset(&locks[i], 0, sizeof(locks[i]));
+        memcpy(locks[i].name, name, sizeof(name));
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+/**
+ * Gets the upper bound of the bucket holding the given percentile.
+ */
+static long long histogram_percentile(const long* histogram, double percentile) {
+    long count = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        count += histogram[b];
+    }
+    if (count == 0) {
+        return 0;
+    }
+    long rank = (long)(count * percentile / 100.0);
+    long seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen > rank) {
+            return 1LL << b;
+        }
+    }
+    return 1LL << (HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * Orders locks by decreasing total wait, then by decreasing total hold.
+ */
+static int compare_contention(const void* a, const void* b) {
+    const lock_stats_t* x = *(const lock_stats_t* const*)a;
+    const lock_stats_t* y = *(const lock_stats_t* const*)b;
+    if (x->wait_ns != y->wait_ns) {
+        return x->wait_ns < y->wait_ns ? 1 : -1;
+    }
+    return (x->hold_ns < y->hold_ns) - (x->hold_ns > y->hold_ns);
+}
+
+void lockprof_report() {
+    if (!ENABLE_LOCK_PROFILING) {
+        return;
+    }
+    lock_stats_t* ranked[MAX_LOCKS];
+    int count = 0;
+    for (int i = 0; i < num_locks; i++) {
+        if (locks[i].acquisitions > 0) {
+            ranked[count++] = &locks[i];
+        }
+    }
+    qsort(ranked, count, sizeof(ranked[0]), compare_contention);
+
+    // Percentiles are bucket upper bounds, so they are powers of two
+    for (int i = 0; i < count; i++) {
+        lock_stats_t* s = ranked[i];
+        printf("[stats] lock #%d %s: acquisitions=%ld contended=%ld (%.1f%%) "
+               "wait total=%.3fms p50<%lldns p99<%lldns max=%lldns "
+               "hold total=%.3fms p50<%lldns p99<%lldns max=%lldns\n",
+               i + 1, s->name, s->acquisitions, s->contended,
+               100.0 * s->contended / s->acquisitions,
+               s->wait_ns / 1e6,
+               histogram_percentile(s->wait_histogram, 50),
+               histogram_percentile(s->wait_histogram, 99),
+               s->max_wait_ns,
+               s->hold_ns / 1e6,
+               histogram_percentile(s->hold_histogram, 50),
+               histogram_percentile(s->hold_histogram, 99),
+               s->max_hold_ns);
+    }
+}
@@ -1,10 +1,38 @@
 #include "shop.h"
+#include "product.h"
+#include "catalog.h"
+#include "pricing.h"
 #include "parameters.h"
+#include <string.h>
+
+/**
+ * Prints the command line usage.
+ */
+static void print_usage(const char* program){
+    fprintf(stderr, "Usage: %s [--catalog FILE] [--promotions FILE]\n", program);
+    fprintf(stderr, "       %s --compile-catalog CATALOG.csv CATALOG.bin\n", program);
+}
+
+int main(int argc, char** argv){
+    if (argc == 4 && strcmp(argv[1], "--compile-catalog") == 0) {
+        int count = catalog_compile(argv[2], argv[3]);
+        printf("Compiled %d products into %s\n", count, argv[3]);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc) {
+            set_product_catalog(argv[++i]);
+        } else if (strcmp(argv[i], "--promotions") == 0 && i + 1 < argc) {
+            set_promotions_file(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
 
-int main(){
     for(int i = 0; i < NUM_SIMULATIONS; i++){
         printf("Simulation %d/%d\n", i + 1, NUM_SIMULATIONS);
         zso();
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,226 @@
+#include "metrics.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** Size of the snapshot buffer */
+#define SNAPSHOT_SIZE 65536
+
+/** How often the exporter checks whether it should stop, in milliseconds */
+#define EXPORTER_POLL_MS 100
+
+/** How long the exporter waits for a client's request, in milliseconds */
+#define REQUEST_WAIT_MS 20
+
+/**
+ * A registered metric, either a counter or a gauge.
+ */
+typedef struct metric_entry_t {
+    const char* name;             // Metric name
+    const char* help;             // Description
+    metrics_counter_t* counter;   // Counter, NULL for a gauge
+    metrics_gauge_fn read;        // Gauge callback, NULL for a counter
+    int instances;                // Number of gauge instances
+    const char* label;            // Label of the gauge instance index
+} metric_entry_t;
+
+/* Global Variables */
+static metric_entry_t registry[MAX_METRICS];
+static int num_metrics = 0;
+static int next_shard = 0;                    // Next counter slot handed to a thread
+static __thread int thread_shard = -1;        // Counter slot of this thread
+
+static pthread_t exporter_thread_id;
+static bool exporter_running = false;         // Cleared to stop the exporter
+static bool exporter_started = false;         // Whether there is a thread to join
+static int listen_fd = -1;
+
+void metrics_reset() {
+    num_metrics = 0;
+}
+
+/**
+ * Adds an entry to the registry, exiting when it is full.
+ */
+static metric_entry_t* add_entry(const char* name, const char* help) {
+    if (num_metrics == MAX_METRICS) {
+        fprintf(stderr, "Error: more than %d metrics registered\n", MAX_METRICS);
+        exit(1);
+    }
+    metric_entry_t* entry = &registry[num_metrics++];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = name;
+    entry->help = help;
+    return entry;
+}
+
+void metrics_register_counter(metrics_counter_t* counter, const char* name, const char* help) {
+    memset(counter, 0, sizeof(*counter));
+    add_entry(name, help)->counter = counter;
+}
+
+void metrics_register_gauge(const char* name, const char* help, metrics_gauge_fn read,
+                            int instances, const char* label) {
+    metric_entry_t* entry = add_entry(name, help);
+    entry->read = read;
+    entry->instances = instances;
+    entry->label = label;
+}
+
+int metrics_shard() {
+    if (thread_shard < 0) {
+        thread_shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) & (METRICS_SHARDS - 1);
+    }
+    return thread_shard;
+}
+
+int metrics_snapshot(char* buffer, int size) {
+    int length = 0;
+    for (int m = 0; m < num_metrics && length < size; m++) {
+        const metric_entry_t* entry = &registry[m];
+        length += snprintf(buffer + length, size - length, "# HELP %s %s\n# TYPE %s %s\n",
+                           entry->name, entry->help, entry->name, entry->counter != NULL ? "counter" : "gauge");
+        if (length >= size) {
+            break;
+        }
+
+        if (entry->counter != NULL) {
+            long total = 0;
+            for (int s = 0; s < METRICS_SHARDS; s++) {
+                total += __atomic_load_n(&entry->counter->shards[s].value, __ATOMIC_RELAXED);
+            }
+            length += snprintf(buffer + length, size - length, "%s %ld\n", entry->name, total);
+        } else if (entry->instances == 1) {
+            length += snprintf(buffer + length, size - length, "%s %.15g\n", entry->name, entry->read(0));
+        } else {
+            for (int i = 0; i < entry->instances && length < size; i++) {
+                length += snprintf(buffer + length, size - length, "%s{%s=\"%d\"} %.15g\n",
+                                   entry->name, entry->label, i, entry->read(i));
+            }
+        }
+    }
+    return length < size ? length : size - 1;
+}
+
+/**
+ * Writes all of a buffer to a socket, giving up on errors.
+ */
+static void write_all(int fd, const char* data, int length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+/**
+ * Answers one client. A client that sends an HTTP request gets an HTTP
+ * response, any other client just gets the snapshot.
+ */
+static void serve_client(int fd, char* snapshot) {
+    char request[1024];
+    int request_length = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, REQUEST_WAIT_MS) > 0) {
+        ssize_t n = read(fd, request, sizeof(request));
+        request_length = n > 0 ? (int)n : 0;
+    }
+
+    int length = metrics_snapshot(snapshot, SNAPSHOT_SIZE);
+    if (request_length >= 3 && memcmp(request, "GET", 3) == 0) {
+        char header[128];
+        int header_length = snprintf(header, sizeof(header),
+                                     "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: %d\r\n\r\n", length);
+        write_all(fd, header, header_length);
+    }
+    write_all(fd, snapshot, length);
+}
+
+/**
+ * Main function for the exporter thread.
+ */
+static void* exporter_thread(void* arg) {
+    (void)arg;
+    char* snapshot = malloc(SNAPSHOT_SIZE);
+    if (snapshot == NULL) {
+        fprintf(stderr, "Error: malloc failed for metrics snapshot\n");
+        exit(1);
+    }
+
+    while (__atomic_load_n(&exporter_running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+        if (poll(&pfd, 1, EXPORTER_POLL_MS) <= 0) {
+            continue;
+        }
+        int client = accept(listen_fd, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+        serve_client(client, snapshot);
+        close(client);
+    }
+
+    free(snapshot);
+    return NULL;
+}
+
+void metrics_exporter_start() {
+    exporter_started = false;
+    if (!ENABLE_METRICS) {
+        return;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, METRICS_SOCKET_PATH, sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(METRICS_SOCKET_PATH); // Left behind by an earlier run
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listen_fd, 8) != 0) {
+        // Metrics are optional, the simulation runs fine without them
+        fprintf(stderr, "Warning: metrics exporter disabled, cannot listen on %s: %s\n",
+                METRICS_SOCKET_PATH, strerror(errno));
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        return;
+    }
+
+    exporter_running = true;
+    int result = pthread_create(&exporter_thread_id, NULL, exporter_thread, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to create metrics exporter thread, error: %d\n", result);
+        exit(1);
+    }
+    exporter_started = true;
+}
+
+void metrics_exporter_stop() {
+    if (!exporter_started) {
+        return;
+    }
+    __atomic_store_n(&exporter_running, false, __ATOMIC_RELEASE);
+    int result = pthread_join(exporter_thread_id, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to join metrics exporter thread, error: %d\n", result);
+        exit(1);
+    }
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(METRICS_SOCKET_PATH);
+    exporter_started = false;
+}
@@ -0,0 +1,274 @@
+#include "perfcount.h"
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/** Number of counted events */
+#define NUM_EVENTS 4
+
+/** Most phases a simulation may have */
+#define MAX_PHASES 8
+
+/**
+ * An event to count.
+ */
+typedef struct perf_event_t {
+    const char* name;   // Name used in the report
+    __u32 type;         // perf_event_attr type
+    __u64 config;       // perf_event_attr config
+} perf_event_t;
+
+static const perf_event_t events[NUM_EVENTS] = {
+    {"cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"llc_misses",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"ctx_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+/* Indices into events[] used by the report */
+#define EVENT_CYCLES 0
+#define EVENT_INSTRUCTIONS 1
+
+static const char* role_names[PERF_NUM_ROLES] = {
+    "main", "spawner", "customer", "clerk", "assistant", "kiosk"
+};
+
+/**
+ * Counters of one live thread.
+ */
+typedef struct perf_thread_t {
+    int fds[NUM_EVENTS];            // Counter per event, -1 when unavailable
+    perf_role_t role;               // Role of the thread
+    struct perf_thread_t* next;     // Next live thread
+} perf_thread_t;
+
+/**
+ * Counts of one phase.
+ */
+typedef struct perf_phase_t {
+    const char* name;
+    long long counts[NUM_EVENTS];
+} perf_phase_t;
+
+/* Global Variables */
+static pthread_mutex_t perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool available[NUM_EVENTS];            // Events the kernel accepted
+static bool warned = false;                   // Unavailable events are reported once
+static perf_thread_t* live_threads = NULL;    // Threads with open counters
+static __thread perf_thread_t* this_thread = NULL;
+
+static long long exited_counts[NUM_EVENTS];   // Counts of threads that have ended
+static long long role_counts[PERF_NUM_ROLES][NUM_EVENTS];
+static int role_threads[PERF_NUM_ROLES];
+
+static perf_phase_t phases[MAX_PHASES];
+static int num_phases = 0;
+static const char* current_phase = NULL;
+static long long phase_start_counts[NUM_EVENTS];
+
+/**
+ * Opens a counter for the calling thread on any CPU.
+ *
+ * @return File descriptor of the counter, -1 if the event is unavailable
+ */
+static int open_counter(const perf_event_t* event) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Hardware events in user space only, which is all an unprivileged
+    // process may count; context switches happen in the kernel
+    if (event->type == PERF_TYPE_HARDWARE) {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+    }
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Reads a counter, scaled up when the kernel multiplexed it with others.
+ */
+static long long read_counter(int fd) {
+    __u64 values[3];   // value, time enabled, time running
+    if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0) {
+        return 0;
+    }
+    if (values[2] < values[1]) {
+        return (long long)((double)values[0] * values[1] / values[2]);
+    }
+    return (long long)values[0];
+}
+
+/**
+ * Opens the counters of the available events for the calling thread.
+ */
+static perf_thread_t* open_thread(perf_role_t role) {
+    perf_thread_t* thread = malloc(sizeof(perf_thread_t));
+    if (thread == NULL) {
+        fprintf(stderr, "Error: malloc failed for performance counters\n");
+        exit(1);
+    }
+    thread->role = role;
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        thread->fds[e] = available[e] ? open_counter(&events[e]) : -1;
+    }
+    return thread;
+}
+
+/**
+ * Adds the counts of every live thread and every ended thread.
+ * Must be called with perf_mutex held.
+ */
+static void total_counts(long long counts[NUM_EVENTS]) {
+    memcpy(counts, exited_counts, sizeof(exited_counts));
+    for (perf_thread_t* thread = live_threads; thread != NULL; thread = thread->next) {
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            if (thread->fds[e] >= 0) {
+                counts[e] += read_counter(thread->fds[e]);
+            }
+        }
+    }
+}
+
+void perf_init(const char* first_phase) {
+    if (!ENABLE_PERF_COUNTERS) {
+        return;
+    }
+    memset(exited_counts, 0, sizeof(exited_counts));
+    memset(role_counts, 0, sizeof(role_counts));
+    memset(role_threads, 0, sizeof(role_threads));
+    memset(phase_start_counts, 0, sizeof(phase_start_counts));
+    num_phases = 0;
+    current_phase = first_phase;
+
+    // Probe every event so threads only open the ones that work
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        int fd = open_counter(&events[e]);
+        available[e] = fd >= 0;
+        if (fd >= 0) {
+            close(fd);
+        } else if (!warned) {
+            fprintf(stderr, "Warning: performance counter %s is unavailable, reporting n/a\n",
+                    events[e].name);
+        }
+    }
+    warned = true;
+
+    perf_thread_begin(PERF_ROLE_MAIN);
+}
+
+void perf_thread_begin(perf_role_t role) {
+    if (!ENABLE_PERF_COUNTERS) {
+        return;
+    }
+    perf_thread_t* thread = open_thread(role);
+    pthread_mutex_lock(&perf_mutex);
+    thread->next = live_threads;
+    live_threads = thread;
+    pthread_mutex_unlock(&perf_mutex);
+    this_thread = thread;
+}
+
+void perf_thread_end() {
+    if (!ENABLE_PERF_COUNTERS || this_thread == NULL) {
+        return;
+    }
+    perf_thread_t* thread = this_thread;
+    this_thread = NULL;
+
+    pthread_mutex_lock(&perf_mutex);
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        if (thread->fds[e] >= 0) {
+            long long count = read_counter(thread->fds[e]);
+            exited_counts[e] += count;
+            role_counts[thread->role][e] += count;
+        }
+    }
+    role_threads[thread->role]++;
+    for (perf_thread_t** link = &live_threads; *link != NULL; link = &(*link)->next) {
+        if (*link == thread) {
+            *link = thread->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&perf_mutex);
+
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        if (thread->fds[e] >= 0) {
+            close(thread->fds[e]);
+        }
+    }
+    free(thread);
+}
+
+void perf_phase(const char* next_phase) {
+    if (!ENABLE_PERF_COUNTERS || current_phase == NULL) {
+        return;
+    }
+    long long counts[NUM_EVENTS];
+    pthread_mutex_lock(&perf_mutex);
+    total_counts(counts);
+    pthread_mutex_unlock(&perf_mutex);
+
+    if (num_phases < MAX_PHASES) {
+        perf_phase_t* phase = &phases[num_phases++];
+        phase->name = current_phase;
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            phase->counts[e] = counts[e] - phase_start_counts[e];
+        }
+    }
+    memcpy(phase_start_counts, counts, sizeof(counts));
+    current_phase = next_phase;
+
+    // The last phase ends with the main thread's own counters
+    if (next_phase == NULL) {
+        perf_thread_end();
+    }
+}
+
+/**
+ * Prints one report line: the counts of every event, n/a when unavailable.
+ */
+static void print_counts(const char* label, const long long counts[NUM_EVENTS]) {
+    printf("[stats] perf: %s", label);
+    for (int e = 0; e < NUM_EVENTS; e++) {
+        if (available[e]) {
+            printf(" %s=%lld", events[e].name, counts[e]);
+        } else {
+            printf(" %s=n/a", events[e].name);
+        }
+        if (e == EVENT_INSTRUCTIONS) {
+            if (available[EVENT_CYCLES] && available[EVENT_INSTRUCTIONS] && counts[EVENT_CYCLES] > 0) {
+                printf(" ipc=%.2f", (double)counts[EVENT_INSTRUCTIONS] / counts[EVENT_CYCLES]);
+            } else {
+                printf(" ipc=n/a");
+            }
+        }
+    }
+    printf("\n");
+}
+
+void perf_report() {
+    if (!ENABLE_PERF_COUNTERS) {
+        return;
+    }
+    char label[64];
+    for (int i = 0; i < num_phases; i++) {
+        snprintf(label, sizeof(label), "phase=%s", phases[i].name);
+        print_counts(label, phases[i].counts);
+    }
+    for (int r = 0; r < PERF_NUM_ROLES; r++) {
+        if (role_threads[r] == 0) {
+            continue;
+        }
+        snprintf(label, sizeof(label), "role=%s threads=%d", role_names[r], role_threads[r]);
+        print_counts(label, role_counts[r]);
+    }
+}
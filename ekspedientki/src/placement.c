@@ -0,0 +1,249 @@
+#define _GNU_SOURCE
+#include "placement.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_NUMA_NODES 64
+
+/* Global Variables */
+static int num_cpus = 0;                      // Number of CPUs this process may run on
+static int* cpu_order = NULL;                 // Usable CPUs in the order they are handed out
+static int* cpu_node = NULL;                  // NUMA node of each entry in cpu_order
+static int num_nodes = 1;                     // Number of NUMA nodes with usable CPUs
+static int clerk_cpu[NUM_CLERKS];             // Planned CPU of each clerk
+static int clerk_node[NUM_CLERKS];            // NUMA node of each clerk
+static int assistant_cpu = -1;                // Planned CPU of the assistant
+static cpu_set_t customer_sets[MAX_NUMA_NODES]; // CPUs customers of a node may use
+static int affinity_warning_printed = 0;      // Print failed pinning only once
+
+/**
+ * Returns a human-readable name of the configured placement policy.
+ */
+static const char* placement_policy_name() {
+    switch (PLACEMENT_POLICY) {
+        case PLACEMENT_COMPACT: return "compact";
+        case PLACEMENT_SCATTER: return "scatter";
+        default: return "none";
+    }
+}
+
+/**
+ * Reads the NUMA node of every CPU from sysfs.
+ * CPUs are left on node 0 when the kernel exposes no NUMA information.
+ *
+ * @param node_of_cpu Array indexed by CPU number, filled with node numbers
+ * @param size Number of entries in node_of_cpu
+ */
+static void read_numa_nodes(int* node_of_cpu, int size) {
+    for (int node = 0; node < MAX_NUMA_NODES; node++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* f = fopen(path, "r");
+        if (f == NULL) {
+            continue;
+        }
+
+        // The list has the form "0-3,8,10-11"
+        int first, last;
+        while (fscanf(f, "%d", &first) == 1) {
+            last = first;
+            int c = fgetc(f);
+            if (c == '-') {
+                if (fscanf(f, "%d", &last) != 1) {
+                    break;
+                }
+                c = fgetc(f);
+            }
+            for (int cpu = first; cpu <= last && cpu < size; cpu++) {
+                node_of_cpu[cpu] = node;
+            }
+            if (c != ',') {
+                break;
+            }
+        }
+        fclose(f);
+    }
+}
+
+/**
+ * Orders the usable CPUs according to the placement policy.
+ * Compact fills one node before moving to the next, scatter takes one CPU
+ * from each node in turn.
+ *
+ * @param cpus Usable CPUs in ascending order
+ * @param nodes NUMA node of each CPU in cpus
+ */
+static void order_cpus(const int* cpus, const int* nodes) {
+    int max_node = 0;
+    for (int i = 0; i < num_cpus; i++) {
+        if (nodes[i] > max_node) max_node = nodes[i];
+    }
+
+    int n = 0;
+    if (PLACEMENT_POLICY == PLACEMENT_SCATTER) {
+        // Round robin over nodes, taking the next unused CPU of each node
+        int* taken = calloc(num_cpus, sizeof(int));
+        if (taken == NULL) {
+            fprintf(stderr, "Error: malloc failed for placement plan\n");
+            exit(1);
+        }
+        while (n < num_cpus) {
+            for (int node = 0; node <= max_node; node++) {
+                for (int i = 0; i < num_cpus; i++) {
+                    if (!taken[i] && nodes[i] == node) {
+                        taken[i] = 1;
+                        cpu_order[n] = cpus[i];
+                        cpu_node[n] = node;
+                        n++;
+                        break;
+                    }
+                }
+            }
+        }
+        free(taken);
+    } else {
+        for (int node = 0; node <= max_node; node++) {
+            for (int i = 0; i < num_cpus; i++) {
+                if (nodes[i] == node) {
+                    cpu_order[n] = cpus[i];
+                    cpu_node[n] = node;
+                    n++;
+                }
+            }
+        }
+    }
+
+    num_nodes = max_node + 1;
+    if (num_nodes > MAX_NUMA_NODES) {
+        num_nodes = MAX_NUMA_NODES;
+    }
+}
+
+void placement_init() {
+    if (PLACEMENT_POLICY == PLACEMENT_NONE) {
+        return;
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        fprintf(stderr, "Warning: sched_getaffinity failed, threads will not be pinned\n");
+        return;
+    }
+
+    int* node_of_cpu = calloc(CPU_SETSIZE, sizeof(int));
+    int* cpus = malloc(sizeof(int) * CPU_SETSIZE);
+    int* nodes = malloc(sizeof(int) * CPU_SETSIZE);
+    cpu_order = malloc(sizeof(int) * CPU_SETSIZE);
+    cpu_node = malloc(sizeof(int) * CPU_SETSIZE);
+    if (node_of_cpu == NULL || cpus == NULL || nodes == NULL || cpu_order == NULL || cpu_node == NULL) {
+        fprintf(stderr, "Error: malloc failed for placement plan\n");
+        exit(1);
+    }
+
+    read_numa_nodes(node_of_cpu, CPU_SETSIZE);
+
+    num_cpus = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus[num_cpus] = cpu;
+            nodes[num_cpus] = node_of_cpu[cpu] < MAX_NUMA_NODES ? node_of_cpu[cpu] : 0;
+            num_cpus++;
+        }
+    }
+    order_cpus(cpus, nodes);
+
+    // Clerks take the first CPUs of the order, the assistant the next one.
+    // With fewer CPUs than threads the plan wraps around.
+    for (int i = 0; i < NUM_CLERKS; i++) {
+        clerk_cpu[i] = cpu_order[i % num_cpus];
+        clerk_node[i] = cpu_node[i % num_cpus];
+    }
+    assistant_cpu = cpu_order[NUM_CLERKS % num_cpus];
+
+    // Customers may use every CPU of their clerk's node except the assistant's
+    for (int node = 0; node < num_nodes; node++) {
+        CPU_ZERO(&customer_sets[node]);
+        for (int i = 0; i < num_cpus; i++) {
+            if (cpu_node[i] == node && cpu_order[i] != assistant_cpu) {
+                CPU_SET(cpu_order[i], &customer_sets[node]);
+            }
+        }
+        if (CPU_COUNT(&customer_sets[node]) == 0) {
+            for (int i = 0; i < num_cpus; i++) {
+                if (cpu_node[i] == node) {
+                    CPU_SET(cpu_order[i], &customer_sets[node]);
+                }
+            }
+        }
+    }
+
+    free(node_of_cpu);
+    free(cpus);
+    free(nodes);
+}
+
+/**
+ * Applies a CPU set to the calling thread, warning once if it fails.
+ */
+static void pin_self(const cpu_set_t* set) {
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), set);
+    if (result != 0 && !__sync_lock_test_and_set(&affinity_warning_printed, 1)) {
+        fprintf(stderr, "Warning: pthread_setaffinity_np failed, error: %d\n", result);
+    }
+}
+
+/**
+ * Pins the calling thread to a single CPU.
+ */
+static void pin_self_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pin_self(&set);
+}
+
+void placement_pin_clerk(int clerk_id) {
+    if (PLACEMENT_POLICY == PLACEMENT_NONE || num_cpus == 0) {
+        return;
+    }
+    pin_self_to_cpu(clerk_cpu[clerk_id]);
+}
+
+void placement_pin_assistant() {
+    if (PLACEMENT_POLICY == PLACEMENT_NONE || num_cpus == 0) {
+        return;
+    }
+    pin_self_to_cpu(assistant_cpu);
+}
+
+void placement_pin_customer(int clerk_id) {
+    if (PLACEMENT_POLICY == PLACEMENT_NONE || num_cpus == 0) {
+        return;
+    }
+    pin_self(&customer_sets[clerk_node[clerk_id]]);
+}
+
+void placement_report() {
+    if (PLACEMENT_POLICY == PLACEMENT_NONE || num_cpus == 0) {
+        printf("[stats] placement: policy=%s\n", placement_policy_name());
+        return;
+    }
+
+    printf("[stats] placement: policy=%s cpus=%d nodes=%d assistant=cpu%d clerks=",
+           placement_policy_name(), num_cpus, num_nodes, assistant_cpu);
+    for (int i = 0; i < NUM_CLERKS; i++) {
+        printf("%scpu%d(node%d)", i > 0 ? "," : "", clerk_cpu[i], clerk_node[i]);
+    }
+    printf("\n");
+}
+
+void placement_destroy() {
+    free(cpu_order);
+    free(cpu_node);
+    cpu_order = NULL;
+    cpu_node = NULL;
+    num_cpus = 0;
+}
@@ -0,0 +1,134 @@
+#include "pqueue.h"
+#include <stdbool.h>
+#include "lockprof.h"
+
+#define PQUEUE_INITIAL_CAPACITY 64
+
+/**
+ * Returns true if entry a must be popped before entry b.
+ */
+static bool entry_before(const pqueue_entry* a, const pqueue_entry* b) {
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    return a->sequence < b->sequence;
+}
+
+/**
+ * Restores the heap order by moving an entry up towards the root.
+ */
+static void sift_up(pqueue* q, int index) {
+    pqueue_entry entry = q->heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!entry_before(&entry, &q->heap[parent])) {
+            break;
+        }
+        q->heap[index] = q->heap[parent];
+        index = parent;
+    }
+    q->heap[index] = entry;
+}
+
+/**
+ * Restores the heap order by moving an entry down towards the leaves.
+ */
+static void sift_down(pqueue* q, int index) {
+    pqueue_entry entry = q->heap[index];
+    while (1) {
+        int child = 2 * index + 1;
+        if (child >= q->size) {
+            break;
+        }
+        if (child + 1 < q->size && entry_before(&q->heap[child + 1], &q->heap[child])) {
+            child++;
+        }
+        if (!entry_before(&q->heap[child], &entry)) {
+            break;
+        }
+        q->heap[index] = q->heap[child];
+        index = child;
+    }
+    q->heap[index] = entry;
+}
+
+pqueue* pqueue_create() {
+    pqueue* q = malloc(sizeof(pqueue));
+    if (q == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        exit(1);
+    }
+    q->heap = malloc(sizeof(pqueue_entry) * PQUEUE_INITIAL_CAPACITY);
+    if (q->heap == NULL) {
+        fprintf(stderr, "Error: malloc failed\n");
+        exit(1);
+    }
+    q->size = 0;
+    q->capacity = PQUEUE_INITIAL_CAPACITY;
+    q->next_sequence = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    return q;
+}
+
+void pqueue_push(pqueue* q, void* data, long long priority) {
+    pthread_mutex_lock(&q->lock);
+    if (q->size == q->capacity) {
+        pqueue_entry* heap = realloc(q->heap, sizeof(pqueue_entry) * q->capacity * 2);
+        if (heap == NULL) {
+            fprintf(stderr, "Error: realloc failed\n");
+            exit(1);
+        }
+        q->heap = heap;
+        q->capacity *= 2;
+    }
+
+    q->heap[q->size].priority = priority;
+    q->heap[q->size].sequence = q->next_sequence++;
+    q->heap[q->size].data = data;
+    sift_up(q, q->size);
+    q->size++;
+
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+int pqueue_pop_batch(pqueue* q, void** out, int max) {
+    if (q == NULL || max <= 0) return 0;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+
+    int count = 0;
+    while (count < max && q->size > 0) {
+        out[count++] = q->heap[0].data;
+        q->heap[0] = q->heap[--q->size];
+        if (q->size > 0) {
+            sift_down(q, 0);
+        }
+    }
+
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+int pqueue_size(pqueue* q) {
+    if (q == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&q->lock);
+    int size = q->size;
+    pthread_mutex_unlock(&q->lock);
+
+    return size;
+}
+
+void pqueue_destroy(pqueue* q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+    free(q->heap);
+    free(q);
+}
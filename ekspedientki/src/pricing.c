@@ -0,0 +1,267 @@
+#include "pricing.h"
+#include "catalog.h"
+#include "product.h"
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PRICING_HAVE_AVX2 1
+#else
+#define PRICING_HAVE_AVX2 0
+#endif
+
+/** Longest rules file line the parser accepts */
+#define RULE_MAX_LINE 256
+
+/* Compiled promotions */
+static const char* promotions_path = NULL; // Rules file, NULL for no promotions
+static const catalog_t* catalog = NULL;    // Catalog the tables were compiled for
+static int32_t* promo_price = NULL;        // Unit price after category discounts, by slot
+static int32_t* multibuy_every = NULL;     // Every n-th unit is free, 0 for no offer, by slot
+static int coupon_min_spend[MAX_COUPONS];  // Smallest basket total a coupon applies to
+static int coupon_cents_off[MAX_COUPONS];  // Amount a coupon takes off the total
+static int num_coupons = 0;
+static int num_rules = 0;
+static bool use_avx2 = false;
+
+void set_promotions_file(const char* path) {
+    promotions_path = path;
+}
+
+/**
+ * Reads the rules file into the per-category, per-slot and coupon tables.
+ */
+static void read_rules(int* category_percent) {
+    FILE* file = fopen(promotions_path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: cannot open promotions %s: %s\n", promotions_path, strerror(errno));
+        exit(1);
+    }
+
+    char line[RULE_MAX_LINE];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0') {
+            continue; // Blank or comment line
+        }
+
+        int a, b;
+        char trailing;
+        if (sscanf(line, " category , %d , %d %c", &a, &b, &trailing) == 2) {
+            if (a < 0 || a >= MAX_CATEGORIES || b < 0 || b > 100) {
+                fprintf(stderr, "Error: %s:%d: invalid category discount\n", promotions_path, line_number);
+                exit(1);
+            }
+            if (b > category_percent[a]) {
+                category_percent[a] = b;
+            }
+        } else if (sscanf(line, " multibuy , %d , %d %c", &a, &b, &trailing) == 2) {
+            int slot = catalog_slot(catalog, a);
+            if (slot < 0 || b < 1) {
+                fprintf(stderr, "Error: %s:%d: invalid multi-buy offer\n", promotions_path, line_number);
+                exit(1);
+            }
+            if (multibuy_every[slot] == 0 || b < multibuy_every[slot]) {
+                multibuy_every[slot] = b;
+            }
+        } else if (sscanf(line, " coupon , %d , %d %c", &a, &b, &trailing) == 2) {
+            if (num_coupons == MAX_COUPONS || a < 0 || b < 0) {
+                fprintf(stderr, "Error: %s:%d: invalid coupon or more than %d coupons\n",
+                        promotions_path, line_number, MAX_COUPONS);
+                exit(1);
+            }
+            coupon_min_spend[num_coupons] = a;
+            coupon_cents_off[num_coupons] = b;
+            num_coupons++;
+        } else {
+            fprintf(stderr, "Error: %s:%d: unknown rule '%s'\n", promotions_path, line_number, line);
+            exit(1);
+        }
+        num_rules++;
+    }
+
+    fclose(file);
+}
+
+void pricing_init() {
+    catalog = product_catalog();
+    num_rules = 0;
+    num_coupons = 0;
+
+    promo_price = malloc(sizeof(int32_t) * catalog->count);
+    multibuy_every = calloc(catalog->count, sizeof(int32_t));
+    if (promo_price == NULL || multibuy_every == NULL) {
+        fprintf(stderr, "Error: malloc failed for pricing tables\n");
+        exit(1);
+    }
+
+    int category_percent[MAX_CATEGORIES] = { 0 };
+    if (promotions_path != NULL) {
+        read_rules(category_percent);
+    }
+
+    // Fold the category discounts into one unit price per product
+    for (int slot = 0; slot < catalog->count; slot++) {
+        int price = catalog->prices[slot];
+        promo_price[slot] = price - price * category_percent[catalog->categories[slot]] / 100;
+    }
+
+    #if PRICING_HAVE_AVX2
+    use_avx2 = __builtin_cpu_supports("avx2");
+    #endif
+}
+
+int pricing_num_coupons() {
+    return num_coupons;
+}
+
+/**
+ * Exits on a product id that is not in the catalog.
+ */
+static void invalid_product() {
+    fprintf(stderr, "Error: Invalid product ID\n");
+    exit(1);
+}
+
+/**
+ * Takes the customer's coupon off a basket total.
+ */
+static int apply_coupon(int total, int coupon) {
+    if (coupon == NO_COUPON) {
+        return total;
+    }
+    if (coupon < 0 || coupon >= num_coupons) {
+        fprintf(stderr, "Error: Invalid coupon %d\n", coupon);
+        exit(1);
+    }
+    if (total >= coupon_min_spend[coupon]) {
+        total -= coupon_cents_off[coupon] < total ? coupon_cents_off[coupon] : total;
+    }
+    return total;
+}
+
+int pricing_price_basket_scalar(const int* product_ids, int count, int coupon) {
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        int slot = catalog_slot(catalog, product_ids[i]);
+        if (slot < 0) {
+            invalid_product();
+        }
+
+        // This item is unit number rank + 1 of its product in the basket
+        int rank = 0;
+        for (int j = 0; j < i; j++) {
+            rank += product_ids[j] == product_ids[i];
+        }
+
+        int every = multibuy_every[slot];
+        if (every == 0 || (rank + 1) % every != 0) {
+            total += promo_price[slot];
+        }
+    }
+    return apply_coupon(total, coupon);
+}
+
+#if PRICING_HAVE_AVX2
+/**
+ * Prices a basket eight items at a time. Slots are found by probing the id
+ * index in all lanes together, unit prices and multi-buy counts are gathered
+ * per vector, and each item's unit number among equal products is counted
+ * with one vector compare per earlier item.
+ */
+__attribute__((target("avx2")))
+static int price_basket_avx2(const int* product_ids, int count, int coupon) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i empty = _mm256_set1_epi32(-1);
+    const __m256i id_mask = _mm256_set1_epi32(catalog->id_index_size - 1);
+    const __m256i id_multiplier = _mm256_set1_epi32((int)2654435761u);
+    __m256i sum = zero;
+
+    for (int base = 0; base < count; base += 8) {
+        __m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - base), lane);
+        __m256i ids = _mm256_maskload_epi32(product_ids + base, active);
+
+        // Reject negative ids, which the id index never holds
+        if (!_mm256_testz_si256(_mm256_cmpgt_epi32(zero, ids), active)) {
+            invalid_product();
+        }
+
+        // Probe the id index in every lane at once, as catalog_slot() does,
+        // until each lane has found its id. An empty bucket means no product.
+        __m256i hash = _mm256_mullo_epi32(ids, id_multiplier);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+        __m256i bucket = _mm256_and_si256(hash, id_mask);
+        __m256i slots = empty;
+        __m256i pending = active;
+        while (!_mm256_testz_si256(pending, pending)) {
+            __m256i keys = _mm256_mask_i32gather_epi32(empty, catalog->id_keys, bucket, pending, 4);
+            if (!_mm256_testz_si256(_mm256_cmpeq_epi32(keys, empty), pending)) {
+                invalid_product();
+            }
+            __m256i found = _mm256_and_si256(_mm256_cmpeq_epi32(keys, ids), pending);
+            slots = _mm256_mask_i32gather_epi32(slots, catalog->id_slots, bucket, found, 4);
+            pending = _mm256_andnot_si256(found, pending);
+            bucket = _mm256_and_si256(_mm256_add_epi32(bucket, one), id_mask);
+        }
+
+        __m256i prices = _mm256_mask_i32gather_epi32(zero, promo_price, slots, active, 4);
+        __m256i every = _mm256_mask_i32gather_epi32(zero, multibuy_every, slots, active, 4);
+
+        // Count the equal products before each item
+        __m256i position = _mm256_add_epi32(lane, _mm256_set1_epi32(base));
+        __m256i rank = zero;
+        int end = base + 8 < count ? base + 8 : count;
+        for (int j = 0; j < end - 1; j++) {
+            __m256i earlier = _mm256_cmpgt_epi32(position, _mm256_set1_epi32(j));
+            __m256i equal = _mm256_cmpeq_epi32(ids, _mm256_set1_epi32(product_ids[j]));
+            rank = _mm256_sub_epi32(rank, _mm256_and_si256(earlier, equal));
+        }
+
+        // The unit is free if its number is a multiple of the offer's count.
+        // An exact multiple divides exactly in float, and no quotient of a
+        // non-multiple times the divisor gives the unit number back, so
+        // rounding in the division cannot change the outcome.
+        __m256i unit = _mm256_add_epi32(rank, one);
+        __m256i divisor = _mm256_max_epi32(every, one);
+        __m256 quotient = _mm256_floor_ps(_mm256_div_ps(_mm256_cvtepi32_ps(unit), _mm256_cvtepi32_ps(divisor)));
+        __m256i multiple = _mm256_mullo_epi32(_mm256_cvttps_epi32(quotient), divisor);
+        __m256i free_unit = _mm256_and_si256(_mm256_cmpeq_epi32(multiple, unit), _mm256_cmpgt_epi32(every, zero));
+
+        sum = _mm256_add_epi32(sum, _mm256_andnot_si256(free_unit, prices));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return apply_coupon(_mm_cvtsi128_si32(half), coupon);
+}
+#endif
+
+int pricing_price_basket(const int* product_ids, int count, int coupon) {
+    #if PRICING_HAVE_AVX2
+    if (use_avx2) {
+        return price_basket_avx2(product_ids, count, coupon);
+    }
+    #endif
+    return pricing_price_basket_scalar(product_ids, count, coupon);
+}
+
+bool pricing_vectorized() {
+    return use_avx2;
+}
+
+void pricing_report() {
+    printf("[stats] pricing: rules=%d coupons=%d code=%s\n",
+           num_rules, num_coupons, use_avx2 ? "avx2" : "scalar");
+}
+
+void pricing_destroy() {
+    free(promo_price);
+    free(multibuy_every);
+    promo_price = NULL;
+    multibuy_every = NULL;
+}
@@ -1,105 +1,384 @@
 #include "product.h"
+#include "catalog.h"
 #include "parameters.h"
+#include "stats.h"
 
 /* Global Variables*/
-product_t products[MAX_PRODUCTS];
-int num_products = 0;
-pthread_mutex_t inventory_mutex;
+static catalog_t catalog;              // Products and their indexes
+static int* central_taken = NULL;      // Units moved out of the central inventory, by slot
+static int* central_restocked = NULL;  // Units the supplier added to the central inventory, by slot
+static uint64_t* low_stock = NULL;     // Bitmap of slots that fell below the restock threshold
+static int* shard_stock[NUM_STOCK_SHARDS]; // Units held by each clerk's shard, by slot
+static const char* catalog_path = NULL; // Catalog file, NULL for the built-in catalog
+static long long catalog_load_ns = 0;  // Time taken by the last initialize_products()
+/**
+ * Counters of one stock shard, only written by the shard's clerk.
+ * Padded so clerks do not share cache lines.
+ */
+typedef struct shard_stats_t {
+    long local_sales;        // Sales served from the shard without synchronization
+    long refills;            // Batches moved in from the central inventory
+    long rebalanced;         // Sales served from another shard's spare stock
+    long stockouts;          // Requests for products with no stock anywhere
+    long cas_retries;        // Failed CAS attempts on the central inventory
+    char pad[64 - 5 * sizeof(long)];
+} shard_stats_t;
 
-#define INIT_PRODUCT(pid, pname, pprice, pstock, passist) \
+static shard_stats_t shard_stats[NUM_STOCK_SHARDS];
+
+#define INIT_PRODUCT(pid, pname, pprice, pstock, passist, pcost, pcategory) \
     do                                                \
     {                                                 \
-        products[pid].id = pid;                       \
-        strcpy(products[pid].name, pname);            \
-        products[pid].price = pprice;                 \
-        /* Scale stock based on customer count */     \
-        float stock_scale = (float)NUM_CUSTOMERS / 100.0f; \
-        int scaled_stock = (int)(pstock * stock_scale); \
-        /* Ensure minimum stock level */              \
-        products[pid].stock = scaled_stock > pstock ? scaled_stock : pstock; \
-        products[pid].needs_assistant = passist;      \
+        builtin[pid].id = pid;                        \
+        strcpy(builtin[pid].name, pname);             \
+        builtin[pid].price = pprice;                  \
+        builtin[pid].stock = pstock;                  \
+        builtin[pid].needs_assistant = passist;       \
+        builtin[pid].prep_cost = pcost;               \
+        builtin[pid].category = pcategory;            \
     } while (0)
 
-void initialize_products(){
-    pthread_mutex_init(&inventory_mutex, NULL); // Initialize the mutex
-    INIT_PRODUCT(0, "Banana", 129, 45, false);
-    INIT_PRODUCT(1, "Apple", 159, 50, false);
-    INIT_PRODUCT(2, "Bread", 349, 32, false);
-    INIT_PRODUCT(3, "Milk", 399, 40, false);
-    INIT_PRODUCT(4, "Eggs", 599, 30, false);
-    INIT_PRODUCT(5, "Pasta", 259, 35, false);
-    INIT_PRODUCT(6, "Rice", 329, 48, false);
-    INIT_PRODUCT(7, "Salt", 159, 60, false);
-    INIT_PRODUCT(8, "Sugar", 289, 55, false);
-    INIT_PRODUCT(9, "Chocolate", 499, 40, false);
-    INIT_PRODUCT(10, "Cheese", 899, 25, false);
-    INIT_PRODUCT(11, "Yogurt", 449, 30, false);
-    INIT_PRODUCT(12, "Butter", 599, 28, false);
-    INIT_PRODUCT(13, "Coffee", 999, 35, false);
-    INIT_PRODUCT(14, "Tea", 599, 40, false);
-    INIT_PRODUCT(15, "Juice", 449, 38, false);
-    INIT_PRODUCT(16, "Water", 149, 70, false);
-    INIT_PRODUCT(17, "Soda", 249, 60, false);
-    INIT_PRODUCT(18, "Chips", 349, 45, false);
-    INIT_PRODUCT(19, "Cookies", 399, 35, false);
-    INIT_PRODUCT(20, "Cereal", 459, 30, false);
-    INIT_PRODUCT(21, "Jam", 399, 25, false);
-    INIT_PRODUCT(22, "Honey", 799, 20, false);
-    INIT_PRODUCT(23, "Nuts", 699, 30, false);
-    INIT_PRODUCT(24, "Peanuts", 499, 35, false);
-    INIT_PRODUCT(25, "Candy", 299, 50, false);
-    INIT_PRODUCT(26, "Pepper", 199, 40, false);
-    INIT_PRODUCT(27, "Oil", 599, 30, false);
-    INIT_PRODUCT(28, "Flour", 349, 35, false);
-    INIT_PRODUCT(29, "Tuna", 599, 30, false);
-    INIT_PRODUCT(30, "Soup", 399, 25, false);
-    INIT_PRODUCT(31, "Beans", 299, 40, false);
-    INIT_PRODUCT(32, "Tomato", 179, 60, false);
-    INIT_PRODUCT(33, "Potato", 199, 55, false);
-    INIT_PRODUCT(34, "Onion", 129, 65, false);
-    INIT_PRODUCT(35, "Garlic", 159, 45, false);
-    INIT_PRODUCT(36, "Lemon", 129, 40, false);
-    INIT_PRODUCT(37, "Orange", 179, 50, false);
-    INIT_PRODUCT(38, "Beef", 1299, 20, false);
-    INIT_PRODUCT(39, "Chicken", 999, 25, false);
-    INIT_PRODUCT(40, "Cake", 899, 15, true);
-    INIT_PRODUCT(41, "Deli Meat", 799, 25, true);
-    INIT_PRODUCT(42, "Fresh Fish", 1299, 20, true);
-    INIT_PRODUCT(43, "Sliced Bread", 399, 30, true);
-    INIT_PRODUCT(44, "Cheese Wheel", 1599, 10, true);
-    INIT_PRODUCT(45, "Custom Coffee", 699, 35, true);
-    INIT_PRODUCT(46, "Watermelon", 599, 20, true);
-    INIT_PRODUCT(47, "Fresh Meat", 1099, 15, true);
-    INIT_PRODUCT(48, "Salad Mix", 349, 30, true);
-    INIT_PRODUCT(49, "Fresh Juice", 899, 25, true);
-}
-
-bool try_get_product(int product_id) {
-    pthread_mutex_lock(&inventory_mutex);
-    
-    bool success = false;
-    if (product_id < MAX_PRODUCTS && products[product_id].stock > 0) {
-        products[product_id].stock--;
-        success = true;
-    }
-    
-    pthread_mutex_unlock(&inventory_mutex);
-    return success;
+/**
+ * Builds the catalog from the products compiled into the program.
+ */
+static void build_builtin_catalog() {
+    product_t builtin[MAX_PRODUCTS];
+    memset(builtin, 0, sizeof(builtin));
+    INIT_PRODUCT(0, "Banana", 129, 45, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(1, "Apple", 159, 50, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(2, "Bread", 349, 32, false, 0, CATEGORY_BAKERY);
+    INIT_PRODUCT(3, "Milk", 399, 40, false, 0, CATEGORY_DAIRY);
+    INIT_PRODUCT(4, "Eggs", 599, 30, false, 0, CATEGORY_DAIRY);
+    INIT_PRODUCT(5, "Pasta", 259, 35, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(6, "Rice", 329, 48, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(7, "Salt", 159, 60, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(8, "Sugar", 289, 55, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(9, "Chocolate", 499, 40, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(10, "Cheese", 899, 25, false, 0, CATEGORY_DAIRY);
+    INIT_PRODUCT(11, "Yogurt", 449, 30, false, 0, CATEGORY_DAIRY);
+    INIT_PRODUCT(12, "Butter", 599, 28, false, 0, CATEGORY_DAIRY);
+    INIT_PRODUCT(13, "Coffee", 999, 35, false, 0, CATEGORY_DRINKS);
+    INIT_PRODUCT(14, "Tea", 599, 40, false, 0, CATEGORY_DRINKS);
+    INIT_PRODUCT(15, "Juice", 449, 38, false, 0, CATEGORY_DRINKS);
+    INIT_PRODUCT(16, "Water", 149, 70, false, 0, CATEGORY_DRINKS);
+    INIT_PRODUCT(17, "Soda", 249, 60, false, 0, CATEGORY_DRINKS);
+    INIT_PRODUCT(18, "Chips", 349, 45, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(19, "Cookies", 399, 35, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(20, "Cereal", 459, 30, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(21, "Jam", 399, 25, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(22, "Honey", 799, 20, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(23, "Nuts", 699, 30, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(24, "Peanuts", 499, 35, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(25, "Candy", 299, 50, false, 0, CATEGORY_SNACKS);
+    INIT_PRODUCT(26, "Pepper", 199, 40, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(27, "Oil", 599, 30, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(28, "Flour", 349, 35, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(29, "Tuna", 599, 30, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(30, "Soup", 399, 25, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(31, "Beans", 299, 40, false, 0, CATEGORY_PANTRY);
+    INIT_PRODUCT(32, "Tomato", 179, 60, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(33, "Potato", 199, 55, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(34, "Onion", 129, 65, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(35, "Garlic", 159, 45, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(36, "Lemon", 129, 40, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(37, "Orange", 179, 50, false, 0, CATEGORY_PRODUCE);
+    INIT_PRODUCT(38, "Beef", 1299, 20, false, 0, CATEGORY_MEAT);
+    INIT_PRODUCT(39, "Chicken", 999, 25, false, 0, CATEGORY_MEAT);
+    INIT_PRODUCT(40, "Cake", 899, 15, true, 4, CATEGORY_BAKERY);
+    INIT_PRODUCT(41, "Deli Meat", 799, 25, true, 2, CATEGORY_MEAT);
+    INIT_PRODUCT(42, "Fresh Fish", 1299, 20, true, 5, CATEGORY_MEAT);
+    INIT_PRODUCT(43, "Sliced Bread", 399, 30, true, 1, CATEGORY_BAKERY);
+    INIT_PRODUCT(44, "Cheese Wheel", 1599, 10, true, 8, CATEGORY_DAIRY);
+    INIT_PRODUCT(45, "Custom Coffee", 699, 35, true, 3, CATEGORY_DRINKS);
+    INIT_PRODUCT(46, "Watermelon", 599, 20, true, 2, CATEGORY_PRODUCE);
+    INIT_PRODUCT(47, "Fresh Meat", 1099, 15, true, 4, CATEGORY_MEAT);
+    INIT_PRODUCT(48, "Salad Mix", 349, 30, true, 1, CATEGORY_PRODUCE);
+    INIT_PRODUCT(49, "Fresh Juice", 899, 25, true, 2, CATEGORY_DRINKS);
+    catalog_build(&catalog, builtin, MAX_PRODUCTS);
 }
 
-int get_product_price(int product_id) {
-    if (product_id < 0 || product_id >= MAX_PRODUCTS) {
+/**
+ * Gets the starting stock of a product, its base stock scaled by the
+ * customer count.
+ */
+static int initial_stock(int slot) {
+    int base_stock = catalog.stock[slot];
+    float stock_scale = (float)NUM_CUSTOMERS / 100.0f;
+    int scaled_stock = (int)(base_stock * stock_scale);
+    // Ensure minimum stock level
+    return scaled_stock > base_stock ? scaled_stock : base_stock;
+}
+
+/**
+ * Gets the slot of a product, exiting on an unknown id.
+ */
+static int checked_slot(int product_id) {
+    int slot = catalog_slot(&catalog, product_id);
+    if (slot < 0) {
         fprintf(stderr, "Error: Invalid product ID\n");
         exit(1);
     }
-    return products[product_id].price;
+    return slot;
+}
+
+void set_product_catalog(const char* path) {
+    catalog_path = path;
+}
+
+void initialize_products(){
+    long long start_ns = now_ns();
+
+    if (catalog_path != NULL) {
+        catalog_load(&catalog, catalog_path);
+    } else {
+        build_builtin_catalog();
+    }
+    if (catalog.count == 0) {
+        fprintf(stderr, "Error: the product catalog is empty\n");
+        exit(1);
+    }
+
+    // Track units taken rather than units left, so startup does not have to
+    // touch every product: the zeroed pages are only faulted in on first sale
+    central_taken = calloc(catalog.count, sizeof(int));
+    central_restocked = calloc(catalog.count, sizeof(int));
+    low_stock = calloc((catalog.count + 63) / 64, sizeof(uint64_t));
+    if (central_taken == NULL || central_restocked == NULL || low_stock == NULL) {
+        fprintf(stderr, "Error: malloc failed for product stock\n");
+        exit(1);
+    }
+    // Each shard is its own allocation so clerks never write the same cache line
+    for (int s = 0; s < NUM_STOCK_SHARDS; s++) {
+        shard_stock[s] = calloc(catalog.count, sizeof(int));
+        if (shard_stock[s] == NULL) {
+            fprintf(stderr, "Error: malloc failed for stock shard\n");
+            exit(1);
+        }
+    }
+    memset(shard_stats, 0, sizeof(shard_stats));
+
+    catalog_load_ns = now_ns() - start_ns;
+}
+
+int product_count() {
+    return catalog.count;
+}
+
+int product_id_at(int slot) {
+    return catalog.ids[slot];
+}
+
+const catalog_t* product_catalog() {
+    return &catalog;
+}
+
+int find_product_by_name(const char* name) {
+    int slot = catalog_find_by_name(&catalog, name);
+    return slot < 0 ? -1 : catalog.ids[slot];
+}
+
+/**
+ * Takes one unit from a shard if it has any. Other clerks only touch a
+ * shard when rebalancing, so for the owner the CAS is uncontended.
+ */
+static bool take_from_shard(int shard, int slot) {
+    int* stock = &shard_stock[shard][slot];
+    int units = __atomic_load_n(stock, __ATOMIC_RELAXED);
+    while (units > 0) {
+        if (__atomic_compare_exchange_n(stock, &units, units - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Moves a batch from the central inventory into a shard, keeping one unit
+ * for the sale in progress. Flags the product for the supplier when the
+ * central inventory falls below the restock threshold.
+ * 
+ * @return true if the central inventory had stock
+ */
+static bool refill_shard(int shard, int slot) {
+    int initial = initial_stock(slot);
+    int taken = __atomic_load_n(&central_taken[slot], __ATOMIC_RELAXED);
+    int available, batch;
+    while (1) {
+        available = initial + __atomic_load_n(&central_restocked[slot], __ATOMIC_ACQUIRE) - taken;
+        batch = available < STOCK_REFILL_BATCH ? available : STOCK_REFILL_BATCH;
+        if (batch <= 0) {
+            return false;
+        }
+        if (__atomic_compare_exchange_n(&central_taken[slot], &taken, taken + batch, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+        shard_stats[shard].cas_retries++;
+    }
+
+    if (RESTOCK_MODE == RESTOCK_THRESHOLD &&
+        (long)(available - batch) * 100 < (long)initial * RESTOCK_THRESHOLD_PCT) {
+        uint64_t bit = 1ULL << (slot % 64);
+        if ((__atomic_load_n(&low_stock[slot / 64], __ATOMIC_RELAXED) & bit) == 0) {
+            __atomic_fetch_or(&low_stock[slot / 64], bit, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (batch > 1) {
+        __atomic_fetch_add(&shard_stock[shard][slot], batch - 1, __ATOMIC_RELEASE);
+    }
+    return batch > 0;
+}
+
+bool try_get_product(int shard, int product_id) {
+    int slot = catalog_slot(&catalog, product_id);
+    if (slot < 0) {
+        return false;
+    }
+    shard_stats_t* stats = &shard_stats[shard];
+
+    // Fast path: our own shard
+    if (take_from_shard(shard, slot)) {
+        stats->local_sales++;
+        return true;
+    }
+
+    // Our shard is empty, move a batch in from the central inventory
+    if (refill_shard(shard, slot)) {
+        stats->refills++;
+        return true;
+    }
+
+    // The central inventory is empty too, sell the spare stock of other
+    // shards. Units only ever leave the central inventory once and each
+    // unit is taken from a shard by a single CAS, so nothing is oversold.
+    for (int i = 1; i < NUM_STOCK_SHARDS; i++) {
+        if (take_from_shard((shard + i) % NUM_STOCK_SHARDS, slot)) {
+            stats->rebalanced++;
+            return true;
+        }
+    }
+
+    stats->stockouts++;
+    return false;
+}
+
+int reserve_basket(int shard, int* product_ids, int count) {
+    int taken = 0;
+    for (int i = 0; i < count; i++) {
+        if (try_get_product(shard, product_ids[i])) {
+            product_ids[taken++] = product_ids[i];
+        }
+    }
+    return taken;
+}
+
+void inventory_levels(long* units, int* out_of_stock) {
+    *units = 0;
+    *out_of_stock = 0;
+    for (int slot = 0; slot < catalog.count; slot++) {
+        long product_units = initial_stock(slot) +
+                             __atomic_load_n(&central_restocked[slot], __ATOMIC_RELAXED) -
+                             __atomic_load_n(&central_taken[slot], __ATOMIC_RELAXED);
+        for (int s = 0; s < NUM_STOCK_SHARDS; s++) {
+            product_units += __atomic_load_n(&shard_stock[s][slot], __ATOMIC_RELAXED);
+        }
+        *units += product_units;
+        *out_of_stock += product_units == 0;
+    }
+}
+
+int restock_product(int slot) {
+    // Only the supplier adds to central_restocked, so the deficit cannot
+    // change under us except by clerks taking more, which a later round fixes
+    int deficit = __atomic_load_n(&central_taken[slot], __ATOMIC_ACQUIRE) -
+                  __atomic_load_n(&central_restocked[slot], __ATOMIC_RELAXED);
+    if (deficit <= 0) {
+        return 0;
+    }
+    __atomic_fetch_add(&central_restocked[slot], deficit, __ATOMIC_RELEASE);
+    return deficit;
+}
+
+long restock_low_products(long* products_restocked) {
+    long units = 0;
+    int words = (catalog.count + 63) / 64;
+    for (int w = 0; w < words; w++) {
+        if (__atomic_load_n(&low_stock[w], __ATOMIC_RELAXED) == 0) {
+            continue;
+        }
+        uint64_t flagged = __atomic_exchange_n(&low_stock[w], 0, __ATOMIC_ACQUIRE);
+        while (flagged != 0) {
+            int slot = w * 64 + __builtin_ctzll(flagged);
+            flagged &= flagged - 1;
+            units += restock_product(slot);
+            (*products_restocked)++;
+        }
+    }
+    return units;
+}
+
+int get_product_price(int product_id) {
+    return catalog.prices[checked_slot(product_id)];
+}
+
+int price_basket(const int* product_ids, int count) {
+    // Only the price column is read, so a basket touches one int per item
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        total += catalog.prices[checked_slot(product_ids[i])];
+    }
+    return total;
 }
 
 bool product_needs_assistant(int product_id)
 {
-    return products[product_id].needs_assistant;
+    return (catalog.flags[checked_slot(product_id)] & PRODUCT_FLAG_NEEDS_ASSISTANT) != 0;
+}
+
+int count_assistant_items(const int* product_ids, int count)
+{
+    int assistant_items = 0;
+    for (int i = 0; i < count; i++) {
+        assistant_items += catalog.flags[checked_slot(product_ids[i])] & PRODUCT_FLAG_NEEDS_ASSISTANT;
+    }
+    return assistant_items;
+}
+
+int product_prep_cost(int product_id)
+{
+    return catalog.prep_costs[checked_slot(product_id)];
+}
+
+void product_report() {
+    printf("[stats] catalog: source=%s products=%d load=%.3fms\n",
+           catalog_path != NULL ? catalog_path : "builtin", catalog.count, catalog_load_ns / 1e6);
+
+    long local_sales = 0, refills = 0, rebalanced = 0, stockouts = 0, cas_retries = 0;
+    for (int s = 0; s < NUM_STOCK_SHARDS; s++) {
+        local_sales += shard_stats[s].local_sales;
+        refills += shard_stats[s].refills;
+        rebalanced += shard_stats[s].rebalanced;
+        stockouts += shard_stats[s].stockouts;
+        cas_retries += shard_stats[s].cas_retries;
+    }
+    long requests = local_sales + refills + rebalanced + stockouts;
+    printf("[stats] inventory: shards=%d refill_batch=%d local=%ld refills=%ld rebalanced=%ld stockouts=%ld "
+           "stockout_rate=%.2f%% cas_retries=%ld\n",
+           NUM_STOCK_SHARDS, STOCK_REFILL_BATCH, local_sales, refills, rebalanced, stockouts,
+           requests > 0 ? 100.0 * stockouts / requests : 0.0, cas_retries);
 }
 
 void destroy_products(){
-    pthread_mutex_destroy(&inventory_mutex);
+    free(central_taken);
+    free(central_restocked);
+    free(low_stock);
+    central_taken = NULL;
+    central_restocked = NULL;
+    low_stock = NULL;
+    for (int s = 0; s < NUM_STOCK_SHARDS; s++) {
+        free(shard_stock[s]);
+        shard_stock[s] = NULL;
+    }
+    catalog_destroy(&catalog);
 }
\ No newline at end of file
@@ -1,4 +1,37 @@
 #include "queue.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "stats.h"
+#include "lockprof.h"
+
+/** Most queues queue_select() waits on */
+#define MAX_SELECT_QUEUES 64
+
+/**
+ * Publishes a new size for queue_size_approx(). Must be called with the lock held.
+ */
+static void set_size(queue* q, int size) {
+    __atomic_store_n(&q->size, size, __ATOMIC_RELAXED);
+}
+
+/**
+ * Unlinks the first node. Must be called with the lock held on a non-empty queue.
+ *
+ * @return The unlinked node, to be freed once the lock is released
+ */
+static queue_node* unlink_head(queue* q) {
+    queue_node* node = q->head;
+    q->head = node->next;
+    set_size(q, q->size - 1);
+    if (q->size == 0) {
+        q->tail = NULL;
+    }
+    return node;
+}
 
 void* queue_pop(queue* q) {
     if (q == NULL) return NULL;
@@ -8,19 +41,90 @@ void* queue_pop(queue* q) {
         pthread_cond_wait(&q->cond, &q->lock);
     }
 
-    queue_node* node = q->head;
+    queue_node* node = unlink_head(q);
+    pthread_mutex_unlock(&q->lock);
+
     void* data = node->data;
-    
-    q->head = node->next;  // Fix: move to next node
-    if (--q->size == 0) {
-        q->tail = NULL;
+    free(node);
+    return data;
+}
+
+void* queue_try_pop(queue* q) {
+    if (q == NULL) return NULL;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->size == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return NULL;
     }
+    queue_node* node = unlink_head(q);
+    pthread_mutex_unlock(&q->lock);
 
+    void* data = node->data;
+    free(node);
+    return data;
+}
+
+void* queue_pop_timeout(queue* q, long long timeout_ns) {
+    if (q == NULL) return NULL;
+
+    // The condition variable runs on CLOCK_MONOTONIC, see queue_create()
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long long deadline_ns = deadline.tv_sec * 1000000000LL + deadline.tv_nsec + timeout_ns;
+    deadline.tv_sec = deadline_ns / 1000000000LL;
+    deadline.tv_nsec = deadline_ns % 1000000000LL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0) {
+        if (pthread_cond_timedwait(&q->cond, &q->lock, &deadline) == ETIMEDOUT && q->size == 0) {
+            pthread_mutex_unlock(&q->lock);
+            return NULL;
+        }
+    }
+    queue_node* node = unlink_head(q);
     pthread_mutex_unlock(&q->lock);
+
+    void* data = node->data;
     free(node);
     return data;
 }
 
+int queue_pop_batch(queue* q, void** out, int max) {
+    if (q == NULL || max <= 0) return 0;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+
+    // Unlink the first nodes while holding the lock, free them afterwards
+    queue_node* first = q->head;
+    queue_node* last = first;
+    int count = 1;
+    while (count < max && last->next != NULL) {
+        last = last->next;
+        count++;
+    }
+
+    q->head = last->next;
+    set_size(q, q->size - count);
+    if (q->size == 0) {
+        q->tail = NULL;
+    }
+
+    pthread_mutex_unlock(&q->lock);
+
+    queue_node* node = first;
+    for (int i = 0; i < count; i++) {
+        queue_node* next = node->next;
+        out[i] = node->data;
+        free(node);
+        node = next;
+    }
+    return count;
+}
+
 void queue_push(queue* q, void* data) {
     queue_node* node = malloc(sizeof(queue_node));
     if (node == NULL) { // Fix: check if malloc failed
@@ -39,9 +143,114 @@ void queue_push(queue* q, void* data) {
     if (q->size == 0) {
         q->head = node;
     }
-    q->size++;
+    set_size(q, q->size + 1);
     pthread_cond_signal(&q->cond);
+    int event_fd = q->event_fd;
+    pthread_mutex_unlock(&q->lock);
+
+    // Wake consumers waiting on the eventfd, outside the lock
+    if (event_fd >= 0) {
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+            fprintf(stderr, "Error: write failed for queue eventfd\n");
+            exit(1);
+        }
+    }
+}
+
+bool queue_remove(queue* q, void* data) {
+    if (q == NULL) return false;
+
+    pthread_mutex_lock(&q->lock);
+    queue_node* previous = NULL;
+    queue_node* node = q->head;
+    while (node != NULL && node->data != data) {
+        previous = node;
+        node = node->next;
+    }
+    if (node != NULL) {
+        if (previous != NULL) {
+            previous->next = node->next;
+        } else {
+            q->head = node->next;
+        }
+        if (q->tail == node) {
+            q->tail = previous;
+        }
+        set_size(q, q->size - 1);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    bool removed = node != NULL;
+    free(node);
+    return removed;
+}
+
+int queue_event_fd(queue* q) {
+    pthread_mutex_lock(&q->lock);
+    if (q->event_fd < 0) {
+        q->event_fd = eventfd((unsigned int)q->size, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (q->event_fd < 0) {
+            fprintf(stderr, "Error: eventfd failed for queue\n");
+            exit(1);
+        }
+    }
+    int event_fd = q->event_fd;
     pthread_mutex_unlock(&q->lock);
+    return event_fd;
+}
+
+void queue_event_clear(queue* q) {
+    uint64_t count;
+    if (read(q->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "Error: read failed for queue eventfd\n");
+        exit(1);
+    }
+}
+
+int queue_select(queue** queues, int count, void** data, long long timeout_ns) {
+    if (count <= 0 || count > MAX_SELECT_QUEUES) {
+        fprintf(stderr, "Error: queue_select on %d queues, 1 to %d are supported\n",
+                count, MAX_SELECT_QUEUES);
+        exit(1);
+    }
+
+    struct pollfd fds[MAX_SELECT_QUEUES];
+    for (int i = 0; i < count; i++) {
+        fds[i].fd = queue_event_fd(queues[i]);
+        fds[i].events = POLLIN;
+    }
+    long long deadline_ns = timeout_ns >= 0 ? now_ns() + timeout_ns : 0;
+
+    while (1) {
+        // Try every queue first, their eventfds are only cleared after waking up
+        for (int i = 0; i < count; i++) {
+            void* item = queue_try_pop(queues[i]);
+            if (item != NULL) {
+                *data = item;
+                return i;
+            }
+        }
+
+        int timeout_ms = -1;
+        if (timeout_ns >= 0) {
+            long long remaining_ns = deadline_ns - now_ns();
+            if (remaining_ns <= 0) {
+                return -1;
+            }
+            timeout_ms = (int)((remaining_ns + 999999) / 1000000);
+        }
+        int ready = poll(fds, (nfds_t)count, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            fprintf(stderr, "Error: poll failed in queue_select\n");
+            exit(1);
+        }
+        for (int i = 0; i < count && ready > 0; i++) {
+            if (fds[i].revents & POLLIN) {
+                queue_event_clear(queues[i]);
+            }
+        }
+    }
 }
 
 queue* queue_create() {
@@ -53,12 +262,22 @@ queue* queue_create() {
     q->head = NULL;
     q->tail = NULL;
     q->size = 0;
+    q->event_fd = -1;
     pthread_mutex_init(&q->lock, NULL);
-    pthread_cond_init(&q->cond, NULL);
+
+    // Timed pops measure their timeout on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->cond, &attr);
+    pthread_condattr_destroy(&attr);
     return q;
 }
 
 void queue_destroy(queue* q) {
+    if (q->event_fd >= 0) {
+        close(q->event_fd);
+    }
     pthread_mutex_destroy(&q->lock);
     pthread_cond_destroy(&q->cond);
     while (q->head != NULL) {
@@ -80,4 +299,11 @@ int queue_size(queue* q) {
     pthread_mutex_unlock(&q->lock);
     
     return size;
-}
\ No newline at end of file
+}
+
+int queue_size_approx(queue* q) {
+    if (q == NULL) {
+        return 0;
+    }
+    return __atomic_load_n(&q->size, __ATOMIC_RELAXED);
+}
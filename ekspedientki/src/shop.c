@@ -5,21 +5,31 @@
 #include "clerk.h"
 #include "parameters.h"
 #include "transaction.h"
+#include "arrival.h"
+#include "admission.h"
+#include "placement.h"
+#include "pricing.h"
+#include "supplier.h"
+#include "metrics.h"
+#include "perfcount.h"
+#include "lockprof.h"
+#include "clerkpool.h"
+#include "kiosk.h"
+#include <limits.h>
+#include <string.h>
+#include <time.h>
 
 /* Global Variables */
-// Mutex for atomic queue operations
-pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
-
 // Customer tracking
 int customers_remaining = 0;          // Track how many customers haven't finished
 pthread_mutex_t customers_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // Global variables for customer spawning
-pthread_mutex_t spawner_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t spawner_cond = PTHREAD_COND_INITIALIZER;
 int active_customers = 0;             // Currently active customer threads
 int customers_spawned = 0;           // Total customers created so far
-pthread_t spawner_thread_id;        // Thread ID for the customer spawner
+static int next_customer_id = 0;      // Next customer ID to be claimed by a spawner
+static int customer_outcomes[NUM_CUSTOMER_OUTCOMES];      // Visits per customer_outcome_t, updated atomically
+pthread_t spawner_thread_ids[NUM_SPAWNERS]; // Thread IDs for the customer spawners
 
 // Global variables for shop earnings
 pthread_mutex_t safe_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -28,6 +38,21 @@ int shop_earnings = 0;                // Total earnings collected from all clerk
 // Customer records array for tracking customer objects
 customer_record_t* customer_records = NULL;
 
+// Latency statistics
+latency_recorder_t customer_latency;   // Arrival-to-exit latency of every customer
+latency_recorder_t item_latency;       // Request-to-response latency of every item after the first
+latency_recorder_t first_item_latency; // Request-to-response latency of first items, queue wait included
+latency_recorder_t basket_latency[MAX_SHOPPING_LIST_SIZE]; // Customer latency by basket size
+static char basket_latency_names[MAX_SHOPPING_LIST_SIZE][32];
+latency_recorder_t job_wait_latency;   // Time clerks spend in wait_for_clerk_jobs
+static long long simulation_start_ns;  // Time the spawner started, arrival offsets are relative to it
+
+// Live metrics
+metrics_counter_t customers_served_metric; // Customers whose checkout finished
+metrics_counter_t items_scanned_metric;    // Item requests handled by clerks
+metrics_counter_t stockouts_metric;        // Item requests that found no stock
+metrics_counter_t sales_cents_metric;      // Payments taken by clerks
+
 /**
  * Generates deterministic pseudo-random numbers.
  * 
@@ -65,9 +90,10 @@ void deposit_to_safe(int amount) {
  * 
  * @param customer_id Unique identifier for the customer
  * @param customers Array to store thread ID
+ * @param arrival_ns Time the customer arrived (or was scheduled to arrive)
  * @return true if customer was created successfully, false otherwise
  */
-static bool create_customer(int customer_id, pthread_t* customers) {
+static bool create_customer(int customer_id, pthread_t* customers, long long arrival_ns) {
     customer_t* c = (customer_t*)malloc(sizeof(customer_t));
     if (c == NULL) {
         fprintf(stderr, "Error: malloc failed for customer\n");
@@ -78,9 +104,23 @@ static bool create_customer(int customer_id, pthread_t* customers) {
     c->id = customer_id;
     c->wallet = get_pseudo_random(customer_id, 100, 5000); 
     c->receipt = NULL;
+    c->arrival_ns = arrival_ns;
+    
+    // Patience varies between half and one and a half times the mean
+    c->patience_deadline_ns = LLONG_MAX;
+    if (CUSTOMER_PATIENCE_US > 0) {
+        c->patience_deadline_ns = arrival_ns +
+            CUSTOMER_PATIENCE_US * 10LL * get_pseudo_random(customer_id * 13 + 5, 50, 150);
+    }
+    
+    // Every fourth customer, on average, brings one of the shop's coupons
+    c->coupon = NO_COUPON;
+    if (pricing_num_coupons() > 0 && get_pseudo_random(customer_id * 7 + 3, 0, 3) == 0) {
+        c->coupon = get_pseudo_random(customer_id, 0, pricing_num_coupons() - 1);
+    }
     
-    // Determine shopping list size (between 1 and 10 items)
-    c->shopping_list_size = get_pseudo_random(customer_id, 1, 10);
+    // Determine shopping list size (between 1 and MAX_SHOPPING_LIST_SIZE items)
+    c->shopping_list_size = get_pseudo_random(customer_id, 1, MAX_SHOPPING_LIST_SIZE);
     
     // Allocate memory for shopping list
     c->shopping_list = (int*)malloc(sizeof(int) * c->shopping_list_size);
@@ -95,36 +135,17 @@ static bool create_customer(int customer_id, pthread_t* customers) {
     for (int j = 0; j < c->shopping_list_size; j++) {
         // Update seed for each item to improve distribution
         seed = seed + j * 31;
-        // Generate product ID in range 0 to (MAX_PRODUCTS-1)
-        c->shopping_list[j] = get_pseudo_random(seed, 0, MAX_PRODUCTS - 1);
-    }
-    
-    // Initialize synchronization primitives
-    int result = pthread_cond_init(&c->cond, NULL);
-    if (result != 0) {
-        fprintf(stderr, "Error: pthread_cond_init failed for customer %d, error: %d\n", 
-                customer_id, result);
-        free(c->shopping_list);
-        free(c);
-        return false;
+        // Pick a product uniformly from the catalog's slots
+        c->shopping_list[j] = product_id_at(get_pseudo_random(seed, 0, product_count() - 1));
     }
     
-    result = pthread_mutex_init(&c->mutex, NULL);
-    if (result != 0) {
-        fprintf(stderr, "Error: pthread_mutex_init failed for customer %d, error: %d\n", 
-                customer_id, result);
-        pthread_cond_destroy(&c->cond);
-        free(c->shopping_list);
-        free(c);
-        return false;
-    }
+    // Initialize the message channel shared with the clerk
+    checkout_channel_init(&c->checkout);
     
     // Create customer thread
-    result = pthread_create(&customers[customer_id], NULL, customer_thread, c);
+    int result = pthread_create(&customers[customer_id], NULL, customer_thread, c);
     if (result != 0) {
         // Creation failed, clean up
-        pthread_mutex_destroy(&c->mutex);
-        pthread_cond_destroy(&c->cond);
         free(c->shopping_list);
         free(c);
         
@@ -150,6 +171,12 @@ static bool create_customer(int customer_id, pthread_t* customers) {
  * @param clerks Array to store clerk thread IDs
  */
 static void create_clerks(pthread_t clerks[]) {
+    if (CLERK_PIPELINE_DEPTH > 1 && CLERK_MAX_INFLIGHT > 1) {
+        fprintf(stderr, "Error: CLERK_PIPELINE_DEPTH (%d) needs CLERK_MAX_INFLIGHT 1, not %d\n",
+                CLERK_PIPELINE_DEPTH, CLERK_MAX_INFLIGHT);
+        exit(1);
+    }
+    
     for (int i = 0; i < NUM_CLERKS; i++) {
         clerk_t* c = (clerk_t*)malloc(sizeof(clerk_t));
         if (c == NULL) {
@@ -176,57 +203,120 @@ static void create_clerks(pthread_t clerks[]) {
 }
 
 /**
- * Thread function that gradually creates customer threads throughout the simulation.
+ * Sleeps until the given point on the monotonic clock.
+ *
+ * @param deadline_ns Absolute wake-up time in nanoseconds
  */
-void* customer_spawner_thread(void* arg) {
-    pthread_t* customers = (pthread_t*)arg;
+static void sleep_until(long long deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = deadline_ns / 1000000000LL;
+    ts.tv_nsec = deadline_ns % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+        // Interrupted by a signal, sleep again until the deadline
+    }
+}
+
+/**
+ * Claims the next customer ID. Several spawners can claim IDs concurrently.
+ * 
+ * @return The claimed ID, or -1 if all customers have already been claimed
+ */
+static int claim_customer_id() {
+    int customer_id = __sync_fetch_and_add(&next_customer_id, 1); // Atomic increment
+    return customer_id < NUM_CUSTOMERS ? customer_id : -1;
+}
+
+/**
+ * Creates a claimed customer, retrying until the creation succeeds,
+ * and updates the counters. No lock is held while creating the customer.
+ * 
+ * @param customer_id Claimed customer ID
+ * @param customers Array to store customer thread IDs
+ * @param arrival_ns Time the customer arrived (or was scheduled to arrive)
+ */
+static void admit_customer(int customer_id, pthread_t* customers, long long arrival_ns) {
+    while (!create_customer(customer_id, customers, arrival_ns)) {
+        // Retry the same customer, IDs must stay contiguous for the joins in zso()
+    }
     
     #if ENABLE_PRINTING
+    int active = __sync_add_and_fetch(&active_customers, 1);
+    int total = __sync_add_and_fetch(&customers_spawned, 1);
     pthread_mutex_lock(&printf_mutex);
-    printf("Customer spawner thread started\n");
+    printf("Created customer %d (active: %d, total: %d)\n", customer_id, active, total);
     pthread_mutex_unlock(&printf_mutex);
+    #else
+    __sync_fetch_and_add(&active_customers, 1);
+    __sync_fetch_and_add(&customers_spawned, 1);
     #endif
-    
-    while (1) {
-        pthread_mutex_lock(&spawner_mutex);
+}
+
+/**
+ * Open-loop spawning: creates every customer at its scheduled arrival time,
+ * regardless of how many customers are still in the shop.
+ * 
+ * @param customers Array to store customer thread IDs
+ */
+static void spawn_open_loop(pthread_t* customers) {
+    int customer_id;
+    while ((customer_id = claim_customer_id()) >= 0) {
+        long long arrival_ns = simulation_start_ns + arrival_offset_ns(customer_id);
+        sleep_until(arrival_ns);
         
+        // Latency is measured from the scheduled arrival, so a late spawner
+        // shows up in the statistics instead of hiding it
+        admit_customer(customer_id, customers, arrival_ns);
+    }
+}
+
+/**
+ * Closed-loop spawning: creates a new customer whenever the number of
+ * active customers drops below MAX_CONCURRENT_CUSTOMERS.
+ * 
+ * @param customers Array to store customer thread IDs
+ */
+static void spawn_closed_loop(pthread_t* customers) {
+    while (1) {
         // Wait until we have room for another customer
-        while (active_customers >= MAX_CONCURRENT_CUSTOMERS) {
-            pthread_cond_wait(&spawner_cond, &spawner_mutex);
-        }
+        admission_acquire();
         
         // Check if we should exit
-        if (customers_spawned >= NUM_CUSTOMERS) {
-            pthread_mutex_unlock(&spawner_mutex);
+        int customer_id = claim_customer_id();
+        if (customer_id < 0) {
+            admission_release(); // Give the unused slot to another spawner
             break;
         }
         
-        // Create a new customer
-        int customer_id = customers_spawned;
-        bool success = create_customer(customer_id, customers);
-        
-        if (success) {
-            // Increment counters
-            active_customers++;
-            customers_spawned++;
-            
-            #if ENABLE_PRINTING
-            pthread_mutex_lock(&printf_mutex);
-            printf("Created customer %d (active: %d, total: %d)\n", 
-                   customer_id, active_customers, customers_spawned);
-            pthread_mutex_unlock(&printf_mutex);
-            #endif
-        }
-        
-        pthread_mutex_unlock(&spawner_mutex);
+        admit_customer(customer_id, customers, now_ns());
+    }
+}
+
+/**
+ * Thread function that gradually creates customer threads throughout the simulation.
+ */
+void* customer_spawner_thread(void* arg) {
+    pthread_t* customers = (pthread_t*)arg;
+    perf_thread_begin(PERF_ROLE_SPAWNER);
+    
+    #if ENABLE_PRINTING
+    pthread_mutex_lock(&printf_mutex);
+    printf("Customer spawner thread started (%s arrivals)\n", arrival_mode_name());
+    pthread_mutex_unlock(&printf_mutex);
+    #endif
+    
+    if (ARRIVAL_MODE == ARRIVAL_CLOSED_LOOP) {
+        spawn_closed_loop(customers);
+    } else {
+        spawn_open_loop(customers);
     }
     
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
-    printf("Customer spawner thread finished, created %d customers\n", customers_spawned);
+    printf("Customer spawner thread finished, %d customers created so far\n", customers_spawned);
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
+    perf_thread_end();
     return NULL;
 }
 
@@ -234,10 +324,136 @@ void* customer_spawner_thread(void* arg) {
  * Signal that a customer has left the shop, allowing a new one to be created.
  */
 void signal_customer_exit() {
-    pthread_mutex_lock(&spawner_mutex);
-    active_customers--;
-    pthread_cond_signal(&spawner_cond);
-    pthread_mutex_unlock(&spawner_mutex);
+    __sync_fetch_and_sub(&active_customers, 1); // Atomic decrement
+    if (ARRIVAL_MODE == ARRIVAL_CLOSED_LOOP) {
+        admission_release();
+    }
+}
+
+void record_customer_outcome(customer_outcome_t outcome) {
+    __sync_fetch_and_add(&customer_outcomes[outcome], 1);
+}
+
+/**
+ * Prints how many customers were served, ran out of patience or balked.
+ * Only printed when customers can leave without being served.
+ */
+static void patience_report() {
+    if (CUSTOMER_PATIENCE_US == 0 && BALK_QUEUE_LENGTH == 0) {
+        return;
+    }
+    int total = customer_outcomes[CUSTOMER_SERVED] + customer_outcomes[CUSTOMER_ABANDONED] +
+                customer_outcomes[CUSTOMER_BALKED];
+    printf("[stats] patience: mean=%dus balk_length=%d served=%d abandoned=%d balked=%d shed=%.1f%%\n",
+           CUSTOMER_PATIENCE_US, BALK_QUEUE_LENGTH, customer_outcomes[CUSTOMER_SERVED],
+           customer_outcomes[CUSTOMER_ABANDONED], customer_outcomes[CUSTOMER_BALKED],
+           total > 0 ? 100.0 * (total - customer_outcomes[CUSTOMER_SERVED]) / total : 0.0);
+}
+
+/**
+ * Prints throughput and latency statistics of the finished simulation.
+ * The throughput line includes the offered load so the output of several
+ * runs at different ARRIVAL_RATE values forms a latency-vs-throughput curve.
+ * 
+ * @param elapsed_ns Time from the start of spawning until the last customer left
+ */
+static void report_statistics(long long elapsed_ns) {
+    double elapsed_s = elapsed_ns / 1e9;
+    double throughput = elapsed_s > 0 ? customers_spawned / elapsed_s : 0;
+    
+    if (ARRIVAL_MODE == ARRIVAL_CLOSED_LOOP) {
+        printf("[stats] throughput: arrivals=%s max_concurrent=%d clerks=%d customers=%d elapsed=%.3fms rate=%.1f/s\n",
+               arrival_mode_name(), MAX_CONCURRENT_CUSTOMERS, NUM_CLERKS, customers_spawned,
+               elapsed_ns / 1e6, throughput);
+    } else {
+        printf("[stats] throughput: arrivals=%s offered=%d/s clerks=%d customers=%d elapsed=%.3fms rate=%.1f/s\n",
+               arrival_mode_name(), ARRIVAL_RATE, NUM_CLERKS, customers_spawned,
+               elapsed_ns / 1e6, throughput);
+    }
+    clerk_pool_report(customer_outcomes[CUSTOMER_SERVED]);
+    clerk_report();
+    kiosk_report();
+    perf_report();
+    patience_report();
+    latency_recorder_report(&customer_latency);
+    for (int i = 0; i < MAX_SHOPPING_LIST_SIZE; i++) {
+        latency_recorder_report(&basket_latency[i]);
+    }
+    latency_recorder_report(&item_latency);
+    latency_recorder_report(&first_item_latency);
+    assistant_report();
+    latency_recorder_report(&job_wait_latency);
+    placement_report();
+    product_report();
+    supplier_report();
+    pricing_report();
+    admission_report();
+    lockprof_report();
+}
+
+/* Gauge callbacks for the live metrics */
+static double read_clerk_queue_depth(int clerk_id) {
+    return customer_queue_size_approx(clerk_queues[clerk_id]);
+}
+
+static double read_assistant_queue_depth(int index) {
+    (void)index;
+    return pqueue_size(assistant_queue);
+}
+
+static double read_active_customers(int index) {
+    (void)index;
+    return __atomic_load_n(&active_customers, __ATOMIC_RELAXED);
+}
+
+static double read_stock_units(int index) {
+    (void)index;
+    long units;
+    int out_of_stock;
+    inventory_levels(&units, &out_of_stock);
+    return units;
+}
+
+static double read_products_out_of_stock(int index) {
+    (void)index;
+    long units;
+    int out_of_stock;
+    inventory_levels(&units, &out_of_stock);
+    return out_of_stock;
+}
+
+static double read_shop_earnings(int index) {
+    (void)index;
+    return __atomic_load_n(&shop_earnings, __ATOMIC_RELAXED);
+}
+
+/**
+ * Registers the simulation's metrics and starts serving them.
+ * Must be called once the queues exist.
+ */
+static void start_metrics() {
+    metrics_reset();
+    metrics_register_counter(&customers_served_metric, "shop_customers_served_total",
+                             "Customers whose checkout finished");
+    metrics_register_counter(&items_scanned_metric, "shop_items_scanned_total",
+                             "Item requests handled by clerks");
+    metrics_register_counter(&stockouts_metric, "shop_stockouts_total",
+                             "Item requests that found no stock");
+    metrics_register_counter(&sales_cents_metric, "shop_sales_cents_total",
+                             "Payments taken by clerks in cents");
+    metrics_register_gauge("shop_clerk_queue_depth", "Customers waiting in each clerk's queue",
+                           read_clerk_queue_depth, NUM_CLERKS, "clerk");
+    metrics_register_gauge("shop_assistant_queue_depth", "Jobs waiting for the assistant",
+                           read_assistant_queue_depth, 1, NULL);
+    metrics_register_gauge("shop_active_customers", "Customers in the shop",
+                           read_active_customers, 1, NULL);
+    metrics_register_gauge("shop_stock_units", "Units in stock over all products",
+                           read_stock_units, 1, NULL);
+    metrics_register_gauge("shop_products_out_of_stock", "Products with no units left",
+                           read_products_out_of_stock, 1, NULL);
+    metrics_register_gauge("shop_earnings_cents", "Money deposited in the safe by clerks that went home",
+                           read_shop_earnings, 1, NULL);
+    metrics_exporter_start();
 }
 
 /**
@@ -246,15 +462,30 @@ void signal_customer_exit() {
 static void cleanup_resources() {
     // Clean up queues
     for (int i = 0; i < NUM_CLERKS; i++) {
-        queue_destroy(clerk_queues[i]);
+        customer_queue_destroy(clerk_queues[i]);
     }
-    queue_destroy(assistant_queue);
+    pqueue_destroy(assistant_queue);
     
     // Clean up clerk inboxes
     cleanup_clerk_inboxes();
     
     // Clean up products
+    pricing_destroy();
     destroy_products();
+    
+    // Clean up admission slots and placement plan
+    admission_destroy();
+    placement_destroy();
+    
+    // Clean up statistics
+    arrival_schedule_destroy();
+    latency_recorder_destroy(&customer_latency);
+    latency_recorder_destroy(&item_latency);
+    latency_recorder_destroy(&first_item_latency);
+    for (int i = 0; i < MAX_SHOPPING_LIST_SIZE; i++) {
+        latency_recorder_destroy(&basket_latency[i]);
+    }
+    latency_recorder_destroy(&job_wait_latency);
 }
 
 /**
@@ -264,15 +495,35 @@ int zso() {
     pthread_t customers[NUM_CUSTOMERS];
     pthread_t clerks[NUM_CLERKS];
     
+    // Count hardware events and lock contention from here on
+    perf_init("setup");
+    lockprof_reset();
+    
     // Initialize products inventory
     initialize_products();
+    pricing_init();
+    supplier_start();
     
     // Initialize simulation state
     customers_remaining = NUM_CUSTOMERS;
     active_customers = 0;
     customers_spawned = 0;
+    next_customer_id = 0;
+    memset(customer_outcomes, 0, sizeof(customer_outcomes));
+    admission_init(MAX_CONCURRENT_CUSTOMERS);
     shop_earnings = 0;
     
+    // Prepare the arrival schedule and latency statistics
+    arrival_schedule_init(NUM_CUSTOMERS);
+    latency_recorder_init(&customer_latency, "customer_latency", NUM_CUSTOMERS);
+    latency_recorder_init(&item_latency, "item_latency", NUM_CUSTOMERS * MAX_SHOPPING_LIST_SIZE);
+    latency_recorder_init(&first_item_latency, "first_item_latency", NUM_CUSTOMERS);
+    for (int i = 0; i < MAX_SHOPPING_LIST_SIZE; i++) {
+        snprintf(basket_latency_names[i], sizeof(basket_latency_names[i]), "basket_%d_latency", i + 1);
+        latency_recorder_init(&basket_latency[i], basket_latency_names[i], NUM_CUSTOMERS);
+    }
+    latency_recorder_init(&job_wait_latency, "clerk_job_wait", NUM_CUSTOMERS);
+    
     // Create customer records array for tracking customer objects
     customer_records = malloc(sizeof(customer_record_t) * NUM_CUSTOMERS);
     if (customer_records == NULL) {
@@ -286,15 +537,22 @@ int zso() {
         customer_records[i].thread_id = 0;
     }
     
-    // Create queues for each clerk
+    // Plan thread placement before any thread starts
+    placement_init();
+    
+    // Create queues for each clerk and open the starting lanes
     for (int i = 0; i < NUM_CLERKS; i++) {
-        clerk_queues[i] = queue_create();
+        clerk_queues[i] = customer_queue_create();
     }
+    clerk_pool_start();
     
     // Create assistant queue and clerk inboxes
-    assistant_queue = queue_create();
+    assistant_queue = pqueue_create();
     initialize_clerk_inboxes();
     
+    // Serve live metrics while the simulation runs
+    start_metrics();
+    
     // Create assistant thread
     int result = pthread_create(&assistant_thread_id, NULL, assistant_thread, NULL);
     if (result != 0) {
@@ -308,29 +566,40 @@ int zso() {
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
-    // Create clerk threads
+    // Create clerk threads and self-checkout kiosk workers
+    clerk_report_reset();
     create_clerks(clerks);
+    kiosks_start();
     
-    // Create customer spawner thread
-    result = pthread_create(&spawner_thread_id, NULL, customer_spawner_thread, customers);
-    if (result != 0) {
-        fprintf(stderr, "Error: Failed to create customer spawner thread, error: %d\n", result);
-        exit(1);
+    // Create customer spawner threads
+    simulation_start_ns = now_ns();
+    for (int i = 0; i < NUM_SPAWNERS; i++) {
+        result = pthread_create(&spawner_thread_ids[i], NULL, customer_spawner_thread, customers);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to create customer spawner thread %d, error: %d\n", i, result);
+            exit(1);
+        }
     }
     
+    perf_phase("spawning");
+    
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
-    printf("All clerks and customer spawner have been created\n");
+    printf("All clerks and customer spawners have been created\n");
     pthread_mutex_unlock(&printf_mutex);
     #endif
     
-    // Join the spawner thread (it will exit when all customers are created)
-    result = pthread_join(spawner_thread_id, NULL);
-    if (result != 0) {
-        fprintf(stderr, "Error: Failed to join customer spawner thread, error: %d\n", result);
-        exit(1);
+    // Join the spawner threads (they exit when all customers are created)
+    for (int i = 0; i < NUM_SPAWNERS; i++) {
+        result = pthread_join(spawner_thread_ids[i], NULL);
+        if (result != 0) {
+            fprintf(stderr, "Error: Failed to join customer spawner thread %d, error: %d\n", i, result);
+            exit(1);
+        }
     }
     
+    perf_phase("serving");
+    
     // Join all customer threads
     for (int i = 0; i < customers_spawned; i++) {
         result = pthread_join(customers[i], NULL);
@@ -340,6 +609,13 @@ int zso() {
         }
     }
     
+    long long simulation_end_ns = now_ns();
+    perf_phase("draining");
+    
+    // No more sales, stop restocking and staffing lanes
+    supplier_stop();
+    clerk_pool_stop();
+    
     #if ENABLE_PRINTING
     pthread_mutex_lock(&printf_mutex);
     printf("All customers have left the shop\n");
@@ -347,7 +623,7 @@ int zso() {
     #endif
     
     // Signal the assistant to stop and join
-    queue_push(assistant_queue, SENTINEL_VALUE);
+    pqueue_push(assistant_queue, SENTINEL_VALUE, LLONG_MAX);
     result = pthread_join(assistant_thread_id, NULL);
     if (result != 0) {
         fprintf(stderr, "Error: Failed to join assistant thread, error: %d\n", result);
@@ -356,7 +632,7 @@ int zso() {
     
     // Join all clerk threads
     for (int i = 0; i < NUM_CLERKS; i++) {
-        queue_push(clerk_queues[i], SENTINEL_VALUE);
+        customer_queue_close(clerk_queues[i]);
     }
     
     for (int i = 0; i < NUM_CLERKS; i++) {
@@ -366,20 +642,29 @@ int zso() {
             exit(1);
         }
     }
+    kiosks_stop();
+    
+    perf_phase("teardown");
+    
+    // Stop serving metrics before the queues they read go away
+    metrics_exporter_stop();
     
     // Print total earnings
     printf("The shop made a total of %d cents during this simulation\n", shop_earnings);
+    perf_phase(NULL);
+    
+    #if ENABLE_STATS
+    report_statistics(simulation_end_ns - simulation_start_ns);
+    #else
+    (void)simulation_end_ns;
+    #endif
     
     // Clean up customer resources now that all threads are joined
     for (int i = 0; i < customers_spawned; i++) {
         if (customer_records[i].customer != NULL) {
             customer_t* customer = customer_records[i].customer;
             
-            // Now it's safe to destroy mutex and condition variable
-            pthread_mutex_destroy(&customer->mutex);
-            pthread_cond_destroy(&customer->cond);
-            
-            // Free the customer structure
+            // Now it's safe to free the customer structure
             free(customer);
             customer_records[i].customer = NULL;
         }
@@ -0,0 +1,134 @@
+#include "spinpark.h"
+#include "stats.h"
+#include <limits.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/** Longest single backoff step in pause iterations */
+#define MAX_BACKOFF 64
+
+/** Smallest budget a waiter shrinks to on a multi-CPU machine */
+#define MIN_SPINS 16
+
+/**
+ * Tells the CPU we are in a spin loop, saving power and giving the
+ * sibling hyperthread more resources.
+ */
+static inline void cpu_relax(void) {
+    #if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+    #elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+    #else
+    __asm__ __volatile__("" ::: "memory");
+    #endif
+}
+
+/**
+ * Number of CPUs, read once. Spinning is pointless on a single CPU because
+ * the thread we wait for cannot run while we spin.
+ */
+static int online_cpus(void) {
+    static int cpus = 0;
+    if (cpus == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        cpus = n > 0 ? (int)n : 1;
+    }
+    return cpus;
+}
+
+void spin_park_init(spin_park_t* p) {
+    p->generation = 0;
+    p->parked = 0;
+}
+
+void spin_budget_init(spin_budget_t* budget) {
+    budget->limit = online_cpus() > 1 ? SPIN_PARK_MAX_SPINS : 0;
+}
+
+void spin_park_wait(spin_park_t* p, spin_budget_t* budget, spin_park_ready_fn ready, void* arg) {
+    spin_park_wait_until(p, budget, ready, arg, LLONG_MAX);
+}
+
+bool spin_park_wait_until(spin_park_t* p, spin_budget_t* budget, spin_park_ready_fn ready, void* arg,
+                          long long deadline_ns) {
+    if (ready(arg)) {
+        return true;
+    }
+
+    // Spin phase: pause with exponential backoff until the budget is used up
+    int spins = 0;
+    int backoff = 1;
+    while (spins < budget->limit) {
+        for (int i = 0; i < backoff; i++) {
+            cpu_relax();
+        }
+        spins += backoff;
+
+        if (ready(arg)) {
+            // The other side answered while we spun, allow spinning
+            // at least twice as long as this answer took next time
+            int wanted = spins * 2;
+            if (wanted > budget->limit) {
+                budget->limit = wanted < SPIN_PARK_MAX_SPINS ? wanted : SPIN_PARK_MAX_SPINS;
+            }
+            return true;
+        }
+
+        if (backoff < MAX_BACKOFF) {
+            backoff *= 2;
+        }
+    }
+
+    // Park phase: sleep on the futex until a notification changes the
+    // generation or the deadline passes
+    bool ready_now = false;
+    while (1) {
+        int generation = __atomic_load_n(&p->generation, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&p->parked, 1, __ATOMIC_SEQ_CST);
+
+        // Re-check after announcing ourselves, so a notifier either sees us
+        // parked or we see the state it published
+        if (ready(arg)) {
+            __atomic_fetch_sub(&p->parked, 1, __ATOMIC_SEQ_CST);
+            ready_now = true;
+            break;
+        }
+
+        if (deadline_ns == LLONG_MAX) {
+            syscall(SYS_futex, &p->generation, FUTEX_WAIT_PRIVATE, generation, NULL, NULL, 0);
+        } else {
+            long long remaining_ns = deadline_ns - now_ns();
+            if (remaining_ns <= 0) {
+                __atomic_fetch_sub(&p->parked, 1, __ATOMIC_SEQ_CST);
+                break;
+            }
+            struct timespec timeout = { remaining_ns / 1000000000LL, remaining_ns % 1000000000LL };
+            syscall(SYS_futex, &p->generation, FUTEX_WAIT_PRIVATE, generation, &timeout, NULL, 0);
+        }
+        __atomic_fetch_sub(&p->parked, 1, __ATOMIC_SEQ_CST);
+
+        if (ready(arg)) {
+            ready_now = true;
+            break;
+        }
+    }
+
+    // The other side was slow, spin for a shorter time next time
+    if (budget->limit > 0 && online_cpus() > 1) {
+        budget->limit /= 2;
+        if (budget->limit < MIN_SPINS && SPIN_PARK_MAX_SPINS >= MIN_SPINS) {
+            budget->limit = MIN_SPINS;
+        }
+    }
+    return ready_now;
+}
+
+void spin_park_notify(spin_park_t* p) {
+    __atomic_fetch_add(&p->generation, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&p->parked, __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, &p->generation, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
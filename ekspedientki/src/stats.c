@@ -0,0 +1,91 @@
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void latency_recorder_init(latency_recorder_t* r, const char* name, int capacity) {
+    r->name = name;
+    r->capacity = capacity;
+    r->count = 0;
+    r->samples = malloc(sizeof(long long) * (capacity > 0 ? capacity : 1));
+    if (r->samples == NULL) {
+        fprintf(stderr, "Error: malloc failed for latency recorder %s\n", name);
+        exit(1);
+    }
+}
+
+void latency_recorder_add(latency_recorder_t* r, long long ns) {
+    int slot = __sync_fetch_and_add(&r->count, 1); // Atomic increment
+    if (slot < r->capacity) {
+        r->samples[slot] = ns;
+    }
+}
+
+/**
+ * Comparison function for sorting samples in ascending order.
+ */
+static int compare_samples(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Number of samples actually stored in the recorder.
+ */
+static int stored_samples(latency_recorder_t* r) {
+    return r->count < r->capacity ? r->count : r->capacity;
+}
+
+long long latency_recorder_percentile(latency_recorder_t* r, double percentile) {
+    int n = stored_samples(r);
+    if (n == 0) {
+        return 0;
+    }
+
+    qsort(r->samples, n, sizeof(long long), compare_samples);
+
+    int index = (int)(percentile / 100.0 * (n - 1) + 0.5);
+    if (index < 0) index = 0;
+    if (index >= n) index = n - 1;
+    return r->samples[index];
+}
+
+void latency_recorder_report(latency_recorder_t* r) {
+    int n = stored_samples(r);
+    if (n == 0) {
+        printf("[stats] %s: n=0\n", r->name);
+        return;
+    }
+
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += r->samples[i];
+    }
+
+    // Percentile sorts the samples, so the maximum is the last one afterwards
+    long long p50 = latency_recorder_percentile(r, 50);
+    long long p90 = latency_recorder_percentile(r, 90);
+    long long p99 = latency_recorder_percentile(r, 99);
+
+    printf("[stats] %s: n=%d mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus max=%.1fus\n",
+           r->name, r->count, sum / n / 1000.0, p50 / 1000.0, p90 / 1000.0,
+           p99 / 1000.0, r->samples[n - 1] / 1000.0);
+}
+
+void latency_recorder_reset(latency_recorder_t* r) {
+    r->count = 0;
+}
+
+void latency_recorder_destroy(latency_recorder_t* r) {
+    free(r->samples);
+    r->samples = NULL;
+    r->capacity = 0;
+    r->count = 0;
+}
@@ -0,0 +1,102 @@
+#include "supplier.h"
+#include "product.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Global Variables */
+static pthread_t supplier_thread_id;
+static bool supplier_running = false;  // Cleared to stop the thread
+static bool supplier_started = false;  // Whether there is a thread to join
+
+/* Supplier statistics, only written by the supplier thread */
+static long rounds = 0;                // Rounds run
+static long products_restocked = 0;    // Products topped up
+static long units_restocked = 0;       // Units added to the central inventory
+static long long busy_ns = 0;          // Time spent restocking
+
+/**
+ * Tops up the next RESTOCK_ROUND_SIZE products, continuing where the
+ * previous round stopped.
+ */
+static void restock_scheduled(int* next_slot) {
+    int count = product_count();
+    int round_size = RESTOCK_ROUND_SIZE < count ? RESTOCK_ROUND_SIZE : count;
+    for (int i = 0; i < round_size; i++) {
+        int units = restock_product(*next_slot);
+        if (units > 0) {
+            units_restocked += units;
+            products_restocked++;
+        }
+        *next_slot = (*next_slot + 1) % count;
+    }
+}
+
+/**
+ * Main function for the supplier thread.
+ */
+static void* supplier_thread(void* arg) {
+    (void)arg;
+    int next_slot = 0;
+    struct timespec interval = {
+        .tv_sec = SUPPLIER_INTERVAL_US / 1000000,
+        .tv_nsec = (SUPPLIER_INTERVAL_US % 1000000) * 1000L
+    };
+
+    while (__atomic_load_n(&supplier_running, __ATOMIC_ACQUIRE)) {
+        nanosleep(&interval, NULL);
+
+        long long start_ns = now_ns();
+        if (RESTOCK_MODE == RESTOCK_SCHEDULED) {
+            restock_scheduled(&next_slot);
+        } else {
+            units_restocked += restock_low_products(&products_restocked);
+        }
+        busy_ns += now_ns() - start_ns;
+        rounds++;
+    }
+    return NULL;
+}
+
+void supplier_start() {
+    rounds = 0;
+    products_restocked = 0;
+    units_restocked = 0;
+    busy_ns = 0;
+    supplier_started = false;
+    if (RESTOCK_MODE == RESTOCK_NONE) {
+        return;
+    }
+
+    supplier_running = true;
+    int result = pthread_create(&supplier_thread_id, NULL, supplier_thread, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to create supplier thread, error: %d\n", result);
+        exit(1);
+    }
+    supplier_started = true;
+}
+
+void supplier_stop() {
+    if (!supplier_started) {
+        return;
+    }
+    __atomic_store_n(&supplier_running, false, __ATOMIC_RELEASE);
+    int result = pthread_join(supplier_thread_id, NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to join supplier thread, error: %d\n", result);
+        exit(1);
+    }
+    supplier_started = false;
+}
+
+void supplier_report() {
+    if (RESTOCK_MODE == RESTOCK_NONE) {
+        return;
+    }
+    printf("[stats] supplier: mode=%s interval=%dus rounds=%ld products=%ld units=%ld busy=%.3fms\n",
+           RESTOCK_MODE == RESTOCK_SCHEDULED ? "scheduled" : "threshold", SUPPLIER_INTERVAL_US,
+           rounds, products_restocked, units_restocked, busy_ns / 1e6);
+}
@@ -0,0 +1,83 @@
+#include "iqueue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+
+typedef struct item_t {
+    int value;
+    struct item_t* next;
+} item_t;
+
+IQUEUE_DECLARE(item_queue, item_t);
+IQUEUE_DEFINE(item_queue, item_t, next)
+
+
+int order_test() {
+    item_queue_t* q = item_queue_create();
+    item_t items[3] = { { .value = 1 }, { .value = 2 }, { .value = 3 } };
+    for (int i = 0; i < 3; i++) {
+        item_queue_push(q, &items[i]);
+    }
+    printf("Size: %d, approx: %d\n", item_queue_size(q), item_queue_size_approx(q));
+    printf("Popped: %d\n", item_queue_pop(q)->value);
+    printf("Popped: %d\n", item_queue_try_pop(q)->value);
+    printf("Popped: %d\n", item_queue_pop(q)->value);
+    printf("Empty try_pop: %p\n", (void*)item_queue_try_pop(q));
+    item_queue_destroy(q);
+    return 0;
+}
+
+int remove_test() {
+    item_queue_t* q = item_queue_create();
+    item_t items[3] = { { .value = 1 }, { .value = 2 }, { .value = 3 } };
+    for (int i = 0; i < 3; i++) {
+        item_queue_push(q, &items[i]);
+    }
+    printf("Removed tail: %d\n", item_queue_remove(q, &items[2]));
+    printf("Removed again: %d\n", item_queue_remove(q, &items[2]));
+    item_queue_push(q, &items[2]);
+    printf("Removed head: %d\n", item_queue_remove(q, &items[0]));
+    printf("Popped: %d\n", item_queue_pop(q)->value);
+    printf("Popped: %d\n", item_queue_pop(q)->value);
+    printf("Size after remove: %d\n", item_queue_size(q));
+    item_queue_destroy(q);
+    return 0;
+}
+
+void* delayed_close(void* arg) {
+    usleep(10000);
+    item_queue_close((item_queue_t*)arg);
+    return NULL;
+}
+
+int close_test() {
+    item_queue_t* q = item_queue_create();
+    item_t item = { .value = 4 };
+    item_queue_push(q, &item);
+    item_queue_close(q);
+    printf("Drained with an item left: %d\n", item_queue_drained(q));
+    printf("Popped after close: %d\n", item_queue_pop(q)->value);
+    printf("Drained: %d, pop: %p\n", item_queue_drained(q), (void*)item_queue_pop(q));
+    item_queue_destroy(q);
+
+    q = item_queue_create();
+    struct pollfd pfd = { .fd = item_queue_event_fd(q), .events = POLLIN };
+    pthread_t thread;
+    pthread_create(&thread, NULL, delayed_close, q);
+    printf("Blocked pop woken by close: %p\n", (void*)item_queue_pop(q));
+    pthread_join(thread, NULL);
+    printf("Readable after close: %d\n", poll(&pfd, 1, 0));
+    item_queue_event_clear(q);
+    printf("Readable after clear: %d\n", poll(&pfd, 1, 0));
+    item_queue_destroy(q);
+    return 0;
+}
+
+int main() {
+    order_test();
+    remove_test();
+    close_test();
+    return 0;
+}
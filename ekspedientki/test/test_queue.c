@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <poll.h>
 #include <unistd.h>
 
 
@@ -52,8 +53,102 @@ int locking_test() {
     return 0;
 }
 
+int remove_test() {
+    queue* q = queue_create();
+    int values[3] = {1, 2, 3};
+    for (int i = 0; i < 3; i++) {
+        queue_push(q, &values[i]);
+    }
+    printf("Removed middle: %d\n", queue_remove(q, &values[1]));
+    printf("Removed again: %d\n", queue_remove(q, &values[1]));
+    printf("Removed tail: %d\n", queue_remove(q, &values[2]));
+    queue_push(q, &values[2]);
+    printf("Size: %d\n", queue_size(q));
+    while (queue_size(q) > 0) {
+        printf("Popped: %d\n", *(int*)queue_pop(q));
+    }
+    queue_destroy(q);
+    return 0;
+}
+
+int try_pop_test() {
+    queue* q = queue_create();
+    int value = 7;
+    printf("Empty try_pop: %p\n", queue_try_pop(q));
+    queue_push(q, &value);
+    printf("try_pop: %d\n", *(int*)queue_try_pop(q));
+    printf("Size after try_pop: %d\n", queue_size(q));
+    queue_push(q, &value);
+    printf("Popped after try_pop: %d\n", *(int*)queue_pop(q));
+    queue_destroy(q);
+    return 0;
+}
+
+int event_fd_test() {
+    queue* q = queue_create();
+    int value = 9;
+    queue_push(q, &value);
+    struct pollfd pfd = { .fd = queue_event_fd(q), .events = POLLIN };
+    printf("Readable with an item queued before: %d\n", poll(&pfd, 1, 0));
+    queue_event_clear(q);
+    printf("Readable after clear: %d\n", poll(&pfd, 1, 0));
+    queue_push(q, &value);
+    printf("Readable after push: %d\n", poll(&pfd, 1, 0));
+    queue_event_clear(q);
+    while (queue_try_pop(q) != NULL) {
+    }
+    printf("Size after draining: %d\n", queue_size(q));
+    queue_destroy(q);
+    return 0;
+}
+
+void* delayed_push(void* arg) {
+    usleep(10000);
+    queue_push((queue*)arg, arg);
+    return NULL;
+}
+
+int pop_timeout_test() {
+    queue* q = queue_create();
+    int value = 11;
+    printf("Empty pop_timeout: %p\n", queue_pop_timeout(q, 1000000));
+    queue_push(q, &value);
+    printf("pop_timeout: %d\n", *(int*)queue_pop_timeout(q, 0));
+    pthread_t thread;
+    pthread_create(&thread, NULL, delayed_push, q);
+    printf("pop_timeout woken by push: %d\n", queue_pop_timeout(q, 1000000000LL) == (void*)q);
+    pthread_join(thread, NULL);
+    queue_destroy(q);
+    return 0;
+}
+
+int select_test() {
+    queue* queues[3] = { queue_create(), queue_create(), queue_create() };
+    int value = 13;
+    void* data = NULL;
+    printf("Empty select: %d\n", queue_select(queues, 3, &data, 1000000));
+    queue_push(queues[2], &value);
+    printf("Approximate size: %d\n", queue_size_approx(queues[2]));
+    int index = queue_select(queues, 3, &data, 0);
+    printf("select: queue %d value %d\n", index, *(int*)data);
+    pthread_t thread;
+    pthread_create(&thread, NULL, delayed_push, queues[1]);
+    index = queue_select(queues, 3, &data, -1);
+    printf("select woken by push: queue %d\n", index);
+    pthread_join(thread, NULL);
+    for (int i = 0; i < 3; i++) {
+        queue_destroy(queues[i]);
+    }
+    return 0;
+}
+
 int main() {
     simple_test();
     locking_test();
+    remove_test();
+    try_pop_test();
+    event_fd_test();
+    pop_timeout_test();
+    select_test();
     return 0;
 }